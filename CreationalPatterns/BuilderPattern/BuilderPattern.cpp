@@ -1,117 +1,12 @@
+#include "BuilderPattern.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
 #include <iostream>
+#include <iterator>
+#include <memory_resource>
 #include <string>
-#include <map>
-#include <vector>
-#include <sstream>
-
-/**
- * Represents an HTTP request with URL, method, headers, query parameters, and body.
- * Built using the Builder design pattern for clean and flexible creation.
- */
-class HttpRequest {
-private:
-    // Member variables
-    std::string url;
-    std::string method;
-    std::map<std::string, std::string> headers;
-    std::map<std::string, std::string> queryParams;
-    std::string body;
-
-    // Private constructor, only accessible from Builder
-    HttpRequest(const std::string& url,
-                const std::string& method,
-                const std::map<std::string, std::string>& headers,
-                const std::map<std::string, std::string>& queryParams,
-                const std::string& body)
-        : url(url), method(method), headers(headers), queryParams(queryParams), body(body) {}
-
-public:
-    // Getters
-    const std::string& getUrl() const { return url; }
-    const std::string& getMethod() const { return method; }
-    const std::map<std::string, std::string>& getHeaders() const { return headers; }
-    const std::map<std::string, std::string>& getQueryParams() const { return queryParams; }
-    const std::string& getBody() const { return body; }
-
-    /**
-     * Builder class for HttpRequest.
-     */
-    class Builder {
-    private:
-        std::string url;
-        std::string method;
-        std::map<std::string, std::string> headers;
-        std::map<std::string, std::string> queryParams;
-        std::string body;
-
-    public:
-        Builder(const std::string& url, const std::string& method) {
-            if (url.empty()) {
-                throw std::invalid_argument("URL is Required");
-            }
-            if (method.empty()) {
-                throw std::invalid_argument("HTTP Method is Required");
-            }
-            this->url = url;
-            this->method = method;
-        }
-
-        Builder& addHeader(const std::string& key, const std::string& value) {
-            headers[key] = value;
-            return *this;
-        }
-
-        Builder& addQueryParam(const std::string& key, const std::string& value) {
-            queryParams[key] = value;
-            return *this;
-        }
-
-        Builder& setBody(const std::string& bodyContent) {
-            body = bodyContent;
-            return *this;
-        }
-
-        HttpRequest build() const {
-            return HttpRequest(url, method, headers, queryParams, body);
-        }
-    };
-
-    /**
-     * Returns a human-readable representation of the HTTP request.
-     */
-    std::string toString() const {
-        std::ostringstream ss;
-        ss << method << " " << url;
-
-        // Add query parameters if present
-        if (!queryParams.empty()) {
-            ss << "?";
-            bool first = true;
-            for (const auto& param : queryParams) {
-                if (!first) ss << "&";
-                ss << param.first << "=" << param.second;
-                first = false;
-            }
-        }
-
-        ss << "\n";
-
-        // Add headers
-        if (!headers.empty()) {
-            ss << "Headers:\n";
-            for (const auto& header : headers) {
-                ss << "  " << header.first << ": " << header.second << "\n";
-            }
-        }
-
-        // Add body
-        if (!body.empty()) {
-            ss << "Body:\n  " << body << "\n";
-        }
-
-        return ss.str();
-    }
-};
 
 /**
  * Demonstrates usage of the HttpRequest and Builder in C++
@@ -134,6 +29,90 @@ int main() {
                                       .build();
 
         std::cout << "\nComplex POST Request:\n" << complexPost.toString() << "\n";
+
+        // Example 3: The same request in HTTP/1.1 wire format, ready to send
+        std::cout << "\nOn the wire (" << complexPost.wireSize() << " bytes):\n" << complexPost.toWire() << "\n";
+
+        // Example 4: Parse the wire bytes back as they arrive, in two reads, without copying them
+        std::string wire = complexPost.toWire();
+        std::string received = wire.substr(0, wire.size() / 2);
+        HttpRequestParser parser;
+        HttpRequestParser::Status status = parser.parse(received);
+        std::cout << "\nAfter the first read: " << (status == HttpRequestParser::Status::NeedMore ? "need more" : "complete") << "\n";
+        received += wire.substr(wire.size() / 2);
+        if (parser.parse(received) == HttpRequestParser::Status::Done) {
+            const HttpRequestView& view = parser.view();
+            std::cout << "Parsed " << view.getMethod() << " " << view.getUrl() << " with "
+                      << view.getHeaders().size() << " headers, Content-Type "
+                      << view.getHeader("content-type").value_or("none") << "\n";
+            std::cout << "As an owning request:\n" << view.toRequest().toString() << "\n";
+        }
+
+        // Example 5: Requests from a template share its URL and common headers; each one stores only its additions
+        HttpRequestTemplate api = HttpRequest::Builder("https://api.example.com/users", "GET")
+                                      .addHeader("Authorization", "Bearer abc123")
+                                      .addQueryParam("version", "1.0")
+                                      .freeze();
+        HttpRequest first = api.request().addQueryParam("id", "123").build();
+        HttpRequest second = api.request().addQueryParam("id", "456").addHeader("Accept", "application/json").build();
+        std::cout << "\nFrom a template:\n" << first.toString() << second.toString() << "\n";
+
+        // Example 6: A request built entirely inside a stack arena, released in one step
+        char arenaBuffer[4096];
+        std::pmr::monotonic_buffer_resource arena(arenaBuffer, sizeof(arenaBuffer));
+        PmrHttpRequest pooled = PmrHttpRequest::Builder("https://api.example.com/users", "DELETE", &arena)
+                                    .addHeader("Authorization", "Bearer abc123")
+                                    .addQueryParam("id", "789")
+                                    .build();
+        std::cout << "\nFrom an arena:\n" << pooled.toString();
+
+        // Example 7: A body generated while it is sent, without knowing its length; it goes out chunked
+        const char* lines[] = {"event: started\n", "event: progress 50%\n", "event: done\n"};
+        size_t nextLine = 0;
+        HttpRequest upload = HttpRequest::Builder("https://api.example.com/events", "POST")
+                                 .addHeader("Content-Type", "text/plain")
+                                 .setBody(BodyStream::generate([&](char* out, size_t capacity) -> size_t {
+                                     if (nextLine == std::size(lines)) {
+                                         return 0;
+                                     }
+                                     size_t length = std::min(std::strlen(lines[nextLine]), capacity);
+                                     std::memcpy(out, lines[nextLine++], length);
+                                     return length;
+                                 }))
+                                 .build();
+        std::cout << "\nStreamed to standard output:\n" << std::flush;
+        upload.sendTo(STDOUT_FILENO);
+        std::cout << "\n";
+
+        // Example 8: The method and required URL checked at compile time, with precomputed header names
+        HttpRequest typed = HttpRequest::TypedBuilder<HttpMethod::Put>()
+                                .url("https://api.example.com/users/123")
+                                .header(KnownHeaders::ContentType, "application/json")
+                                .header(KnownHeaders::Authorization, "Bearer abc123")
+                                .body("{\"name\": \"Alice\"}")
+                                .build();
+        std::cout << "\nTyped builder:\n" << typed.toString();
+
+        // Example 9: A fan-out batch from one template, serialized in parallel into buffers ready for one writev()
+        std::string_view ids[] = {"123", "456", "789"};
+        QueryColumn columns[] = {{"id", ids}};
+        BatchSerializer serializer(/*threadCount=*/2);
+        BatchSerializer::Result batch = serializer.serialize(api, columns);
+        std::cout << "\nBatch of " << batch.size() << " requests, " << batch.bytes() << " bytes in "
+                  << batch.vectors().size() << " buffers; the last one:\n" << batch[batch.size() - 1];
+
+        // Example 10: Fingerprints identify requests for response caches; query parameter order does not matter
+        constexpr HeaderName varyHeaders[] = {KnownHeaders::Accept};
+        HttpRequest idFirst = HttpRequest::Builder("https://api.example.com/users", "GET")
+                                  .addQueryParam("id", "123")
+                                  .addQueryParam("version", "1.0")
+                                  .build();
+        HttpRequest versionFirst = HttpRequest::Builder("https://api.example.com/users", "GET")
+                                       .addQueryParam("version", "1.0")
+                                       .addQueryParam("id", "123")
+                                       .build();
+        std::cout << "\nSame fingerprint with parameters reordered? "
+                  << (idFirst.fingerprint(varyHeaders) == versionFirst.fingerprint(varyHeaders) ? "true" : "false") << "\n";
     } catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << "\n";
     }
@@ -0,0 +1,2233 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <map>
+#include <array>
+#include <vector>
+#include <optional>
+#include <memory>
+#include <memory_resource>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <system_error>
+#include <span>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Vector that keeps up to N elements inside the object and moves them to memory
+ * from its allocator only when it grows past that. Limited to trivially copyable elements.
+ */
+template <typename T, size_t N, typename Allocator = std::allocator<T>>
+class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector copies elements bytewise");
+
+public:
+    SmallVector() = default;
+    explicit SmallVector(const Allocator& allocator) : spilled(allocator) {}
+
+    SmallVector(const SmallVector& other)
+        : SmallVector(other, std::allocator_traits<Allocator>::select_on_container_copy_construction(other.spilled.get_allocator())) {}
+
+    // Only the elements in use are copied; the rest of the inline array stays uninitialized.
+    SmallVector(const SmallVector& other, const Allocator& allocator) : spilled(other.spilled, allocator), count(other.count) {
+        if (spilled.empty()) {
+            std::memcpy(inlineItems.data(), other.inlineItems.data(), count * sizeof(T));
+        }
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            spilled = other.spilled;
+            count = other.count;
+            if (spilled.empty()) {
+                std::memcpy(inlineItems.data(), other.inlineItems.data(), count * sizeof(T));
+            }
+        }
+        return *this;
+    }
+
+    SmallVector(SmallVector&& other) noexcept : spilled(std::move(other.spilled)), count(other.count) {
+        if (spilled.empty()) {
+            std::memcpy(inlineItems.data(), other.inlineItems.data(), count * sizeof(T));
+        }
+        other.clear();
+    }
+
+    SmallVector& operator=(SmallVector&& other) {
+        if (this != &other) {
+            spilled = std::move(other.spilled);
+            count = other.count;
+            if (spilled.empty()) {
+                std::memcpy(inlineItems.data(), other.inlineItems.data(), count * sizeof(T));
+            }
+            other.clear();
+        }
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T* data() { return spilled.empty() ? inlineItems.data() : spilled.data(); }
+    const T* data() const { return spilled.empty() ? inlineItems.data() : spilled.data(); }
+
+    T& operator[](size_t index) { return data()[index]; }
+    const T& operator[](size_t index) const { return data()[index]; }
+
+    void push_back(const T& item) {
+        if (spilled.empty()) {
+            if (count < N) {
+                inlineItems[count++] = item;
+                return;
+            }
+            spilled.reserve(2 * N);
+            spilled.assign(inlineItems.begin(), inlineItems.end());
+        }
+        spilled.push_back(item);
+        ++count;
+    }
+
+    void clear() {
+        count = 0;
+        spilled.clear();
+    }
+
+private:
+    std::array<T, N> inlineItems;
+    std::vector<T, Allocator> spilled; // holds every element once the inline array has overflowed
+    size_t count = 0;
+};
+
+/**
+ * Allocator-independent parts of BasicFieldList.
+ */
+struct FieldListBase {
+    enum class Names {
+        CaseSensitive,  // query parameters
+        CaseInsensitive // header names, per RFC 9110
+    };
+
+    struct Field {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    static constexpr bool equalIgnoringCase(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (lower(a[i]) != lower(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // True if name is an RFC 9110 token, the grammar of a header name.
+    static constexpr bool isToken(std::string_view name) {
+        if (name.empty()) {
+            return false;
+        }
+        for (char c : name) {
+            bool alphanumeric = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+            if (!alphanumeric && std::string_view("!#$%&'*+-.^_`|~").find(c) == std::string_view::npos) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    static constexpr std::array<std::string_view, 20> kWellKnownHeaders = {
+        "Accept", "Accept-Encoding", "Accept-Language", "Authorization", "Cache-Control",
+        "Connection", "Content-Encoding", "Content-Length", "Content-Type", "Cookie",
+        "Host", "If-Modified-Since", "If-None-Match", "Origin", "Range",
+        "Referer", "Transfer-Encoding", "User-Agent", "X-Forwarded-For", "X-Request-Id",
+    };
+
+    static constexpr char lower(char c) { return c >= 'A' && c <= 'Z' ? char(c + ('a' - 'A')) : c; }
+
+    // FNV-1a; only used to skip names that cannot match, so 32 bits are plenty.
+    static constexpr uint32_t nameHash(std::string_view name, Names names) {
+        uint32_t hash = 2166136261u;
+        for (char c : name) {
+            hash = (hash ^ uint8_t(names == Names::CaseInsensitive ? lower(c) : c)) * 16777619u;
+        }
+        return hash;
+    }
+
+    static constexpr uint8_t kNotInterned = 0xFF;
+
+    static constexpr uint8_t wellKnownIndex(std::string_view name) {
+        for (size_t i = 0; i < kWellKnownHeaders.size(); ++i) {
+            if (equalIgnoringCase(kWellKnownHeaders[i], name)) {
+                return uint8_t(i);
+            }
+        }
+        return kNotInterned;
+    }
+
+public:
+    /**
+     * A header name checked and hashed at compile time. Setting a header through
+     * one skips hashing the name and searching the well-known names at run time.
+     */
+    class HeaderName {
+    public:
+        consteval HeaderName(std::string_view name)
+            : text(name), hash(nameHash(name, Names::CaseInsensitive)), interned(wellKnownIndex(name)) {
+            if (!isToken(name)) {
+                throw "A header name must be a non-empty RFC 9110 token";
+            }
+        }
+
+        constexpr std::string_view name() const { return text; }
+
+    private:
+        template <typename Allocator>
+        friend class BasicFieldList;
+
+        std::string_view text;
+        uint32_t hash;
+        uint8_t interned;
+    };
+};
+
+using HeaderName = FieldListBase::HeaderName;
+
+/**
+ * Precomputed names for the headers most requests set.
+ */
+struct KnownHeaders {
+    static constexpr HeaderName Accept{"Accept"};
+    static constexpr HeaderName Authorization{"Authorization"};
+    static constexpr HeaderName ContentType{"Content-Type"};
+    static constexpr HeaderName UserAgent{"User-Agent"};
+};
+
+/**
+ * Ordered list of name/value fields, used for headers and query parameters.
+ * All names and values are packed into one character buffer indexed by a
+ * SmallVector, so a typical list costs one allocation instead of a tree node and
+ * two strings per field. Fields keep their insertion order; setting a name that
+ * is already present replaces its value and keeps its position.
+ * Lists created with Names::CaseInsensitive compare names ignoring ASCII case
+ * and intern well-known header names, which are stored as a reference to their
+ * canonical spelling instead of being copied.
+ * A list can also be layered over a shared, immutable base list. It then holds
+ * only its own fields: setting a name the base has overrides that field in its
+ * position, and other names come after the base's fields. Copies share the base.
+ * The text and any overflowing index come from Allocator.
+ */
+template <typename Allocator = std::allocator<char>>
+class BasicFieldList : public FieldListBase {
+public:
+    class Iterator {
+    public:
+        Iterator(const BasicFieldList* list, size_t index) : list(list), index(index) {}
+        Field operator*() const { return (*list)[index]; }
+        Iterator& operator++() {
+            ++index;
+            return *this;
+        }
+        bool operator==(const Iterator& other) const { return index == other.index; }
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+
+    private:
+        const BasicFieldList* list;
+        size_t index;
+    };
+
+    explicit BasicFieldList(Names names = Names::CaseSensitive, const Allocator& allocator = Allocator())
+        : names(names), text(allocator), entries(EntryAllocator(allocator)) {}
+
+    // An empty layer over base, which must not change while this list uses it.
+    explicit BasicFieldList(std::shared_ptr<const BasicFieldList> base, const Allocator& allocator = Allocator())
+        : names(base->names), base(std::move(base)), text(allocator), entries(EntryAllocator(allocator)) {}
+
+    BasicFieldList(const BasicFieldList& other)
+        : BasicFieldList(other, std::allocator_traits<Allocator>::select_on_container_copy_construction(other.get_allocator())) {}
+
+    // Copies are packed, dropping the space left behind by replaced values.
+    BasicFieldList(const BasicFieldList& other, const Allocator& allocator)
+        : names(other.names), base(other.base), overrides(other.overrides), text(allocator), entries(EntryAllocator(allocator)) {
+        text.reserve(other.text.size() - other.wasted);
+        for (size_t i = 0; i < other.entries.size(); ++i) {
+            Entry entry = other.entries[i];
+            Field field = other.fieldOf(entry);
+            if (entry.interned == kNotInterned) {
+                entry.nameOffset = append(field.name);
+            }
+            entry.valueOffset = append(field.value);
+            entries.push_back(entry);
+        }
+    }
+
+    BasicFieldList& operator=(const BasicFieldList& other) {
+        if (this != &other) {
+            BasicFieldList copy(other, get_allocator());
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    // Moved-from lists are left empty.
+    BasicFieldList(BasicFieldList&& other) noexcept
+        : names(other.names), base(std::move(other.base)), overrides(std::exchange(other.overrides, 0)),
+          text(std::move(other.text)), wasted(std::exchange(other.wasted, 0)), entries(std::move(other.entries)) {
+        other.text.clear();
+    }
+
+    BasicFieldList& operator=(BasicFieldList&& other) {
+        if (this != &other) {
+            names = other.names;
+            base = std::move(other.base);
+            overrides = std::exchange(other.overrides, 0);
+            text = std::move(other.text);
+            wasted = std::exchange(other.wasted, 0);
+            entries = std::move(other.entries);
+            other.text.clear();
+        }
+        return *this;
+    }
+
+    /**
+     * Adds a field, or replaces the value of the field with the same name.
+     * @throws std::length_error if the list would exceed 4 GiB of text.
+     */
+    void set(std::string_view name, std::string_view value) {
+        insert(name, hashName(name), names == Names::CaseInsensitive ? wellKnownIndex(name) : kNotInterned, value);
+    }
+
+    /**
+     * Adds or replaces a header through a name prepared at compile time.
+     * @throws std::length_error if the list would exceed 4 GiB of text.
+     */
+    void set(const HeaderName& name, std::string_view value) {
+        if (names != Names::CaseInsensitive) {
+            set(name.text, value);
+            return;
+        }
+        insert(name.text, name.hash, name.interned, value);
+    }
+
+    /**
+     * @return The value stored under the name, or std::nullopt if there is none.
+     */
+    std::optional<std::string_view> find(std::string_view name) const {
+        uint32_t hash = hashName(name);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const Entry& entry = entries[i];
+            if (entry.hash == hash && nameEquals(nameOf(entry), name)) {
+                return std::string_view(text.data() + entry.valueOffset, entry.valueLength);
+            }
+        }
+        return base ? base->find(name) : std::nullopt;
+    }
+
+    // Looks a header up through a name prepared at compile time, without hashing it.
+    std::optional<std::string_view> find(const HeaderName& name) const {
+        if (names != Names::CaseInsensitive) {
+            return find(name.text);
+        }
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const Entry& entry = entries[i];
+            if (matches(entry, name.text, name.hash, name.interned)) {
+                return std::string_view(text.data() + entry.valueOffset, entry.valueLength);
+            }
+        }
+        return base ? base->find(name) : std::nullopt;
+    }
+
+    // Map-style lookups, for code written against the former std::map accessors.
+    size_t count(std::string_view name) const { return find(name) ? 1 : 0; }
+    bool contains(std::string_view name) const { return find(name).has_value(); }
+
+    /**
+     * Copies the fields into a std::map, the type getHeaders() and getQueryParams()
+     * returned before they became FieldLists. The map orders names by byte value;
+     * interned header names come out in their canonical spelling.
+     */
+    std::map<std::string, std::string> toMap() const {
+        std::map<std::string, std::string> map;
+        for (Field field : *this) {
+            map.emplace(field.name, field.value);
+        }
+        return map;
+    }
+
+    // Layered lists take time proportional to their own field count per access.
+    Field operator[](size_t index) const {
+        if (!base) {
+            return fieldOf(entries[index]);
+        }
+        size_t inherited = base->size();
+        if (index < inherited) {
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (entries[i].overrides == index) {
+                    return fieldOf(entries[i]);
+                }
+            }
+            return (*base)[index];
+        }
+        index -= inherited;
+        for (size_t i = 0;; ++i) {
+            if (entries[i].overrides == kNoOverride && index-- == 0) {
+                return fieldOf(entries[i]);
+            }
+        }
+    }
+
+    size_t size() const { return (base ? base->size() : 0) + entries.size() - overrides; }
+    bool empty() const { return size() == 0; }
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, size()); }
+
+    void clear() {
+        entries.clear();
+        text.clear();
+        wasted = 0;
+        base.reset();
+        overrides = 0;
+    }
+
+    Allocator get_allocator() const { return text.get_allocator(); }
+
+private:
+    static constexpr size_t kInlineFields = 16;
+    static constexpr uint32_t kNoOverride = UINT32_MAX;
+    static constexpr size_t kNotFound = SIZE_MAX;
+
+    struct Entry {
+        uint32_t hash;        // of the name, folded to lower case for header lists
+        uint32_t nameOffset;  // into text; unused for interned names
+        uint32_t nameLength;
+        uint32_t valueOffset; // into text
+        uint32_t valueLength;
+        uint32_t overrides;   // index of the base field this one replaces, or kNoOverride
+        uint8_t interned;     // index into kWellKnownHeaders, or kNotInterned
+    };
+
+    Field fieldOf(const Entry& entry) const {
+        return {nameOf(entry), std::string_view(text.data() + entry.valueOffset, entry.valueLength)};
+    }
+
+    // Position of the field with the name as operator[] numbers it, or kNotFound.
+    size_t indexOf(std::string_view name) const {
+        uint32_t hash = hashName(name);
+        size_t added = 0;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const Entry& entry = entries[i];
+            if (entry.hash == hash && nameEquals(nameOf(entry), name)) {
+                return entry.overrides != kNoOverride ? entry.overrides : (base ? base->size() : 0) + added;
+            }
+            added += entry.overrides == kNoOverride;
+        }
+        return base ? base->indexOf(name) : kNotFound;
+    }
+
+    using EntryAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Entry>;
+
+    // A well-known name is always interned, so interned names match on their index alone.
+    bool matches(const Entry& entry, std::string_view name, uint32_t hash, uint8_t interned) const {
+        return entry.hash == hash && (interned != kNotInterned ? entry.interned == interned : nameEquals(nameOf(entry), name));
+    }
+
+    void insert(std::string_view name, uint32_t hash, uint8_t interned, std::string_view value) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            Entry& entry = entries[i];
+            if (matches(entry, name, hash, interned)) {
+                if (value.size() <= entry.valueLength) {
+                    std::memmove(text.data() + entry.valueOffset, value.data(), value.size());
+                    wasted += entry.valueLength - value.size();
+                } else {
+                    wasted += entry.valueLength;
+                    entry.valueOffset = append(value);
+                }
+                entry.valueLength = uint32_t(value.size());
+                return;
+            }
+        }
+        Entry entry{hash, 0, uint32_t(name.size()), 0, uint32_t(value.size()), kNoOverride, interned};
+        if (base) {
+            size_t inherited = base->indexOf(name);
+            if (inherited != kNotFound) {
+                entry.overrides = uint32_t(inherited);
+                ++overrides;
+            }
+        }
+        if (entry.interned == kNotInterned) {
+            entry.nameOffset = append(name);
+        }
+        entry.valueOffset = append(value);
+        entries.push_back(entry);
+    }
+
+    uint32_t hashName(std::string_view name) const { return nameHash(name, names); }
+
+    bool nameEquals(std::string_view stored, std::string_view name) const {
+        return names == Names::CaseSensitive ? stored == name : equalIgnoringCase(stored, name);
+    }
+
+    std::string_view nameOf(const Entry& entry) const {
+        if (entry.interned != kNotInterned) {
+            return kWellKnownHeaders[entry.interned];
+        }
+        return std::string_view(text.data() + entry.nameOffset, entry.nameLength);
+    }
+
+    uint32_t append(std::string_view bytes) {
+        if (bytes.size() > UINT32_MAX - text.size()) {
+            throw std::length_error("HTTP field list exceeds 4 GiB");
+        }
+        if (text.capacity() == 0) {
+            text.reserve(256); // room for a typical request's fields in one allocation
+        }
+        uint32_t offset = uint32_t(text.size());
+        text.append(bytes);
+        return offset;
+    }
+
+    Names names;
+    std::shared_ptr<const BasicFieldList> base; // fields shared with other lists, or null
+    size_t overrides = 0;                   // entries that replace a base field
+    std::basic_string<char, std::char_traits<char>, Allocator> text; // every stored name and value, back to back
+    size_t wasted = 0; // bytes in text no longer referenced by any entry
+    SmallVector<Entry, kInlineFields, EntryAllocator> entries;
+};
+
+using FieldList = BasicFieldList<>;
+
+/**
+ * Ordered name/value fields that refer to text owned elsewhere, such as a receive
+ * buffer. The read-only counterpart of FieldList, used by HttpRequestView.
+ */
+class FieldViews {
+public:
+    using Field = FieldList::Field;
+
+    explicit FieldViews(FieldList::Names names = FieldList::Names::CaseSensitive) : names(names) {}
+
+    void add(std::string_view name, std::string_view value) { fields.push_back({name, value}); }
+
+    /**
+     * @return The value of the first field with the name, or std::nullopt if there is none.
+     */
+    std::optional<std::string_view> find(std::string_view name) const {
+        for (size_t i = 0; i < fields.size(); ++i) {
+            std::string_view stored = fields[i].name;
+            if (names == FieldList::Names::CaseSensitive ? stored == name : FieldList::equalIgnoringCase(stored, name)) {
+                return fields[i].value;
+            }
+        }
+        return std::nullopt;
+    }
+
+    const Field& operator[](size_t index) const { return fields[index]; }
+    size_t size() const { return fields.size(); }
+    bool empty() const { return fields.empty(); }
+    const Field* begin() const { return fields.data(); }
+    const Field* end() const { return fields.data() + fields.size(); }
+    void clear() { fields.clear(); }
+
+private:
+    FieldList::Names names;
+    SmallVector<Field, 16> fields;
+};
+
+/**
+ * Helpers for writing and scanning requests in HTTP/1.1 wire format (RFC 9112).
+ */
+struct HttpWire {
+    static constexpr std::string_view kVersion = "HTTP/1.1";
+
+    // Characters RFC 3986 allows unescaped in a query component; everything else is %XX-encoded.
+    static constexpr std::array<bool, 256> kUnreserved = [] {
+        std::array<bool, 256> table{};
+        for (int c = 0; c < 256; ++c) {
+            table[c] = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                       c == '-' || c == '.' || c == '_' || c == '~';
+        }
+        return table;
+    }();
+
+    static size_t percentEncodedSize(std::string_view text) {
+        size_t size = text.size();
+        for (char c : text) {
+            size += kUnreserved[uint8_t(c)] ? 0 : 2;
+        }
+        return size;
+    }
+
+    static char* percentEncode(std::string_view text, char* out) {
+        static constexpr char kHex[] = "0123456789ABCDEF";
+        for (char c : text) {
+            uint8_t byte = uint8_t(c);
+            if (kUnreserved[byte]) {
+                *out++ = c;
+            } else {
+                *out++ = '%';
+                *out++ = kHex[byte >> 4];
+                *out++ = kHex[byte & 0xF];
+            }
+        }
+        return out;
+    }
+
+    static char* put(char* out, std::string_view text) {
+        if (!text.empty()) {
+            std::memcpy(out, text.data(), text.size());
+        }
+        return out + text.size();
+    }
+
+    /**
+     * Request target and Host header of a URL. An absolute URL ("https://host/path?q")
+     * yields origin-form "/path?q" and host "host"; anything else is sent as is with
+     * no host. Fragments are never sent.
+     */
+    struct Target {
+        std::string_view authority;
+        std::string_view path; // including any query string already in the URL
+
+        // True when the path needs a leading '/' to be a valid request target.
+        bool needsLeadingSlash() const { return path.empty() || path.front() == '?'; }
+    };
+
+    static Target splitUrl(std::string_view url) {
+        url = url.substr(0, url.find('#'));
+        size_t scheme = url.find("://");
+        if (scheme == std::string_view::npos) {
+            return {{}, url};
+        }
+        std::string_view rest = url.substr(scheme + 3);
+        size_t pathStart = 0; // a plain loop; find_first_of tests each byte against the set with memchr
+        while (pathStart < rest.size() && rest[pathStart] != '/' && rest[pathStart] != '?') {
+            ++pathStart;
+        }
+        return {rest.substr(0, pathStart), rest.substr(pathStart)};
+    }
+
+    /**
+     * @return The first occurrence of byte in [begin, end), or end if there is none.
+     * Compares 16 bytes at a time with SSE2 where available.
+     */
+    static const char* findByte(const char* begin, const char* end, char byte) {
+#if defined(__SSE2__)
+        const __m128i needle = _mm_set1_epi8(byte);
+        for (; end - begin >= 16; begin += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+            if (int matches = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle))) {
+                return begin + __builtin_ctz(unsigned(matches));
+            }
+        }
+#endif
+        for (; begin != end; ++begin) {
+            if (*begin == byte) {
+                return begin;
+            }
+        }
+        return end;
+    }
+
+    static bool hexValue(char c, uint8_t& value) {
+        if (c >= '0' && c <= '9') {
+            value = uint8_t(c - '0');
+        } else if (c >= 'A' && c <= 'F') {
+            value = uint8_t(c - 'A' + 10);
+        } else if (c >= 'a' && c <= 'f') {
+            value = uint8_t(c - 'a' + 10);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Decodes %XX escapes; malformed escapes are kept as they are.
+     */
+    static std::string percentDecode(std::string_view text) {
+        std::string decoded;
+        decoded.reserve(text.size());
+        for (size_t i = 0; i < text.size(); ++i) {
+            uint8_t high, low;
+            if (text[i] == '%' && i + 2 < text.size() && hexValue(text[i + 1], high) && hexValue(text[i + 2], low)) {
+                decoded.push_back(char(high << 4 | low));
+                i += 2;
+            } else {
+                decoded.push_back(text[i]);
+            }
+        }
+        return decoded;
+    }
+
+    /**
+     * Writes every byte of parts to fd, retrying partial writes and EINTR.
+     * @throws std::system_error if a write fails.
+     */
+    static void writeAll(int fd, iovec* parts, int count) {
+        while (count > 0) {
+            ssize_t written = ::writev(fd, parts, count);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "writev");
+            }
+            size_t left = size_t(written);
+            while (count > 0 && left >= parts->iov_len) {
+                left -= parts->iov_len;
+                ++parts;
+                --count;
+            }
+            if (count > 0) {
+                parts->iov_base = static_cast<char*>(parts->iov_base) + left;
+                parts->iov_len -= left;
+            }
+        }
+    }
+
+    // True if text holds a space or control character, none of which a request target may contain.
+    static bool hasSpaceOrControl(std::string_view text) {
+        bool found = false;
+        for (char c : text) {
+            found |= uint8_t(c) <= ' ' || c == 0x7F;
+        }
+        return found;
+    }
+
+    // Content-Length and Transfer-Encoding frame the body, so only the serializer writes them.
+    static bool isFramingHeader(std::string_view name) {
+        return FieldListBase::equalIgnoringCase(name, "Content-Length") ||
+               FieldListBase::equalIgnoringCase(name, "Transfer-Encoding");
+    }
+
+    // True if text holds a control character other than HTAB, which RFC 9110 field values exclude.
+    static bool hasFieldControl(std::string_view text) {
+        bool found = false;
+        for (char c : text) {
+            found |= (uint8_t(c) < ' ' && c != '\t') || c == 0x7F;
+        }
+        return found;
+    }
+
+    static bool hasLineBreak(std::string_view text) {
+        bool found = false;
+        for (char c : text) {
+            found |= c == '\r' || c == '\n';
+        }
+        return found;
+    }
+
+    static size_t decimalDigits(size_t value) {
+        size_t digits = 1;
+        while (value >= 10) {
+            value /= 10;
+            ++digits;
+        }
+        return digits;
+    }
+};
+
+/**
+ * 128-bit identity of a request, for cache keys.
+ */
+struct RequestFingerprint {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    friend bool operator==(const RequestFingerprint&, const RequestFingerprint&) = default;
+};
+
+/**
+ * Seeded 128-bit hash over a sequence of byte strings, used by HttpRequest::fingerprint().
+ * Every multiplication takes one operand keyed by the seed, so input cannot cancel
+ * the seed out of the state without knowing it. It is fast rather than
+ * cryptographic, and kDefaultSeed is public: a cache keyed by fingerprints of
+ * requests from untrusted clients should use a secret seed, which makes collisions
+ * hard to choose but is no substitute for a keyed PRF such as SipHash.
+ * Input is taken 16 bytes at a time into two independent 64-bit lanes, which the
+ * CPU overlaps. Each string is length-prefixed, so ("ab", "c") and ("a", "bc") differ.
+ */
+class FingerprintHasher {
+public:
+    static constexpr uint64_t kDefaultSeed = 0x2d358dccaa6c78a5ull;
+
+    explicit FingerprintHasher(uint64_t seed = kDefaultSeed)
+        : lowKey(scramble(seed ^ kLowKeys[1])), highKey(scramble(seed ^ kHighKeys[1])),
+          low(seed ^ kLowKeys[0]), high(seed ^ kHighKeys[0]) {}
+
+    // foldCase hashes ASCII letters as lower case, for case-insensitive parts such as the host.
+    void add(std::string_view bytes, bool foldCase = false) {
+        size_t i = 0;
+        uint64_t first = i + 8 <= bytes.size() ? load(bytes.data(), 8, foldCase) : load(bytes.data(), bytes.size(), foldCase);
+        absorb(bytes.size(), first);
+        for (i = 8; i + 16 <= bytes.size(); i += 16) {
+            absorb(load(bytes.data() + i, 8, foldCase), load(bytes.data() + i + 8, 8, foldCase));
+        }
+        if (i < bytes.size()) {
+            size_t left = bytes.size() - i;
+            absorb(load(bytes.data() + i, std::min<size_t>(left, 8), foldCase),
+                   left > 8 ? load(bytes.data() + i + 8, left - 8, foldCase) : 0);
+        }
+    }
+
+    void add(const RequestFingerprint& part) { absorb(part.low, part.high); }
+    void addWord(uint64_t word) { absorb(word, 0); }
+
+    RequestFingerprint finish() const {
+        uint64_t a = mix(low ^ kLowKeys[1], high ^ lowKey);
+        uint64_t b = mix(high ^ kLowKeys[0], low ^ highKey);
+        return {mix(b, a ^ highKey), a ^ b};
+    }
+
+    /**
+     * Order-independent combine: the sum of the parts modulo 2^128, so a set of
+     * fields gives the same result whatever order its fields were added in.
+     */
+    static RequestFingerprint combineUnordered(const RequestFingerprint& sum, const RequestFingerprint& part) {
+        uint64_t low = sum.low + part.low;
+        return {sum.high + part.high + (low < sum.low), low};
+    }
+
+private:
+    static constexpr uint64_t kLowKeys[2] = {0x9e3779b97f4a7c15ull, 0xe7037ed1a0b428dbull};
+    static constexpr uint64_t kHighKeys[2] = {0xd6e8feb86659fd93ull, 0x8ebc6af09c88c6e3ull};
+
+    // The second operand is keyed: with a public constant there, the block equal to
+    // that constant would zero the product and erase the seed from the lane.
+    void absorb(uint64_t a, uint64_t b) {
+        low = mix(a ^ low ^ kLowKeys[0], b ^ lowKey);
+        high = mix(b ^ high ^ kHighKeys[0], a ^ highKey);
+    }
+
+    // Bijective 64-bit finalizer (SplitMix64), so distinct seeds give distinct keys.
+    static constexpr uint64_t scramble(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    // Folds the full 128-bit product, so every input bit reaches every output bit.
+    static uint64_t mix(uint64_t a, uint64_t b) {
+        unsigned __int128 product = (unsigned __int128)a * b;
+        return uint64_t(product) ^ uint64_t(product >> 64);
+    }
+
+    // Up to eight bytes as one word, with fixed-size loads only; for a given count
+    // every byte lands in the word, and the hashed length tells the counts apart.
+    static uint64_t load(const char* bytes, size_t count, bool foldCase) {
+        uint64_t word = 0;
+        if (count == 8) {
+            std::memcpy(&word, bytes, 8);
+        } else if (count >= 4) {
+            uint32_t head, tail; // overlapping when count < 8
+            std::memcpy(&head, bytes, 4);
+            std::memcpy(&tail, bytes + count - 4, 4);
+            word = head | uint64_t(tail) << 32;
+        } else if (count > 0) {
+            word = uint8_t(bytes[0]) | uint64_t(uint8_t(bytes[count / 2])) << 8 | uint64_t(uint8_t(bytes[count - 1])) << 16;
+        }
+        return foldCase ? lowerWord(word) : word;
+    }
+
+    // ASCII lower case of eight bytes at once.
+    static uint64_t lowerWord(uint64_t word) {
+        constexpr uint64_t kOnes = 0x0101010101010101ull;
+        constexpr uint64_t kHigh = 0x8080808080808080ull;
+        uint64_t aboveA = (word & ~kHigh) + kOnes * (0x80 - 'A');
+        uint64_t aboveZ = (word & ~kHigh) + kOnes * (0x80 - 'Z' - 1);
+        uint64_t upper = aboveA & ~aboveZ & ~word & kHigh;
+        return word | (upper >> 2);
+    }
+
+    uint64_t lowKey; // seed-derived multiplier keys
+    uint64_t highKey;
+    uint64_t low;
+    uint64_t high;
+};
+
+/**
+ * Request body that is produced while the request is sent instead of being held
+ * in memory: a chunk generator, a range of a file (sent with sendfile) or a
+ * memory-mapped file. Bodies of known length are sent with Content-Length, others
+ * with chunked transfer encoding. Copies share the same source, which is read once.
+ */
+class BodyStream {
+public:
+    /**
+     * Writes up to capacity bytes of the body into out and returns how many it
+     * wrote; returning 0 ends the body.
+     */
+    using Generator = std::function<size_t(char* out, size_t capacity)>;
+
+    enum class Kind { Generated, File, Mapped };
+
+    /**
+     * A body produced by next; with a length it is sent with Content-Length and
+     * next must produce exactly that many bytes.
+     */
+    static BodyStream generate(Generator next, std::optional<size_t> length = std::nullopt) {
+        BodyStream stream(Kind::Generated);
+        stream.next = std::move(next);
+        stream.knownLength = length;
+        return stream;
+    }
+
+    /**
+     * length bytes of fd from offset. The caller keeps fd open until the request is sent.
+     */
+    static BodyStream file(int fd, off_t offset, size_t length) {
+        BodyStream stream(Kind::File);
+        stream.fd = fd;
+        stream.offset = offset;
+        stream.knownLength = length;
+        return stream;
+    }
+
+    /**
+     * The whole file at path, which stays open for as long as the body exists.
+     * @throws std::system_error if it cannot be opened.
+     */
+    static BodyStream openFile(const std::string& path) {
+        auto handle = std::make_shared<FileHandle>(path);
+        BodyStream stream = file(handle->fd, 0, handle->size);
+        stream.owner = std::move(handle);
+        return stream;
+    }
+
+    /**
+     * The whole file at path, mapped read-only for as long as the body exists.
+     * @throws std::system_error if it cannot be opened or mapped.
+     */
+    static BodyStream mapFile(const std::string& path) {
+        FileHandle file(path);
+        BodyStream stream(Kind::Mapped);
+        stream.knownLength = file.size;
+        if (file.size > 0) {
+            auto mapping = std::make_shared<Mapping>(file.fd, file.size);
+            stream.region = std::string_view(static_cast<const char*>(mapping->address), file.size);
+            stream.owner = std::move(mapping);
+        }
+        return stream;
+    }
+
+    Kind kind() const { return sourceKind; }
+    std::optional<size_t> length() const { return knownLength; }
+    std::string_view mapped() const { return region; } // the bytes of a Mapped body
+
+private:
+    friend struct BodySender;
+
+    struct FileHandle {
+        int fd;
+        size_t size = 0;
+
+        explicit FileHandle(const std::string& path) : fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+            struct stat status;
+            if (fd < 0 || ::fstat(fd, &status) != 0) {
+                int error = errno;
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                throw std::system_error(error, std::generic_category(), "open " + path);
+            }
+            size = size_t(status.st_size);
+        }
+        FileHandle(const FileHandle&) = delete;
+        FileHandle& operator=(const FileHandle&) = delete;
+        ~FileHandle() { ::close(fd); }
+    };
+
+    struct Mapping {
+        void* address;
+        size_t length;
+
+        Mapping(int fd, size_t length) : address(::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0)), length(length) {
+            if (address == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "mmap");
+            }
+            ::madvise(address, length, MADV_SEQUENTIAL);
+        }
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+        ~Mapping() { ::munmap(address, length); }
+    };
+
+    explicit BodyStream(Kind kind) : sourceKind(kind) {}
+
+    Kind sourceKind;
+    Generator next;
+    std::optional<size_t> knownLength;
+    int fd = -1;
+    off_t offset = 0;
+    std::string_view region;
+    std::shared_ptr<const void> owner; // keeps an opened file or a mapping alive
+};
+
+/**
+ * Sends BodyStream bodies after a request head, holding at most kChunkBytes of
+ * the body in memory at a time.
+ */
+struct BodySender {
+    static constexpr size_t kChunkBytes = 16 * 1024;
+
+    // Sends head, then the body; the head goes out in the same writev() as the first bytes when possible.
+    static void send(int fd, std::string_view head, const BodyStream& stream) {
+        iovec headPart{const_cast<char*>(head.data()), head.size()};
+        switch (stream.kind()) {
+        case BodyStream::Kind::Mapped: {
+            iovec parts[2] = {headPart, {const_cast<char*>(stream.region.data()), stream.region.size()}};
+            HttpWire::writeAll(fd, parts, stream.region.empty() ? 1 : 2);
+            return;
+        }
+        case BodyStream::Kind::File:
+            HttpWire::writeAll(fd, &headPart, 1);
+            sendFile(fd, stream.fd, stream.offset, *stream.knownLength);
+            return;
+        case BodyStream::Kind::Generated: {
+            std::unique_ptr<char[]> buffer(new char[kChunkBytes]);
+            if (stream.knownLength) {
+                sendGenerated(fd, headPart, stream, buffer.get());
+            } else {
+                sendChunked(fd, headPart, stream, buffer.get());
+            }
+            return;
+        }
+        }
+    }
+
+private:
+    static void sendFile(int fd, int source, off_t offset, size_t length) {
+        bool copy = false; // set when sendfile() cannot serve this pair of descriptors
+        std::unique_ptr<char[]> buffer;
+        while (length > 0) {
+            if (!copy) {
+                ssize_t sent = ::sendfile(fd, source, &offset, length);
+                if (sent > 0) {
+                    length -= size_t(sent);
+                    continue;
+                }
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                    copy = true;
+                    buffer.reset(new char[kChunkBytes]);
+                    continue;
+                }
+                if (sent == 0) {
+                    throw std::runtime_error("body file ended before its declared length");
+                }
+                throw std::system_error(errno, std::generic_category(), "sendfile");
+            }
+            ssize_t read = ::pread(source, buffer.get(), std::min(length, kChunkBytes), offset);
+            if (read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (read < 0) {
+                throw std::system_error(errno, std::generic_category(), "pread");
+            }
+            if (read == 0) {
+                throw std::runtime_error("body file ended before its declared length");
+            }
+            iovec part{buffer.get(), size_t(read)};
+            HttpWire::writeAll(fd, &part, 1);
+            offset += read;
+            length -= size_t(read);
+        }
+    }
+
+    static void sendGenerated(int fd, iovec head, const BodyStream& stream, char* buffer) {
+        size_t remaining = *stream.knownLength;
+        iovec parts[2] = {head, {buffer, 0}};
+        int count = 1;
+        do {
+            size_t produced = remaining > 0 ? stream.next(buffer, std::min(remaining, kChunkBytes)) : 0;
+            if (produced > remaining || (produced == 0 && remaining > 0)) {
+                throw std::runtime_error("body generator produced a different length than declared");
+            }
+            remaining -= produced;
+            parts[count++] = {buffer, produced};
+            HttpWire::writeAll(fd, parts, count);
+            count = 0;
+        } while (remaining > 0);
+    }
+
+    static void sendChunked(int fd, iovec head, const BodyStream& stream, char* buffer) {
+        char size[20];
+        iovec parts[4] = {head};
+        int count = 1;
+        for (;;) {
+            size_t produced = stream.next(buffer, kChunkBytes);
+            if (produced == 0) {
+                parts[count++] = {const_cast<char*>("0\r\n\r\n"), 5};
+                HttpWire::writeAll(fd, parts, count);
+                return;
+            }
+            char* end = std::to_chars(size, size + sizeof(size) - 2, produced, 16).ptr;
+            *end++ = '\r';
+            *end++ = '\n';
+            parts[count++] = {size, size_t(end - size)};
+            parts[count++] = {buffer, produced};
+            parts[count++] = {const_cast<char*>("\r\n"), 2};
+            HttpWire::writeAll(fd, parts, count);
+            count = 0;
+        }
+    }
+};
+
+template <typename Allocator>
+class BasicHttpRequestTemplate;
+
+/**
+ * Request methods known at compile time, for HttpRequest::TypedBuilder.
+ */
+enum class HttpMethod {
+    Get,
+    Head,
+    Post,
+    Put,
+    Patch,
+    Delete,
+    Options
+};
+
+inline constexpr std::string_view httpMethodName(HttpMethod method) {
+    switch (method) {
+    case HttpMethod::Get: return "GET";
+    case HttpMethod::Head: return "HEAD";
+    case HttpMethod::Post: return "POST";
+    case HttpMethod::Put: return "PUT";
+    case HttpMethod::Patch: return "PATCH";
+    case HttpMethod::Delete: return "DELETE";
+    case HttpMethod::Options: return "OPTIONS";
+    }
+    return "";
+}
+
+/**
+ * Represents an HTTP request with URL, method, headers, query parameters, and body.
+ * Built using the Builder design pattern for clean and flexible creation.
+ * Every string and field list of a request comes from Allocator; with
+ * std::pmr::polymorphic_allocator (PmrHttpRequest) a whole request can live in a
+ * per-request arena such as std::pmr::monotonic_buffer_resource.
+ */
+template <typename Allocator = std::allocator<char>>
+class BasicHttpRequest {
+public:
+    using String = std::basic_string<char, std::char_traits<char>, Allocator>;
+    using Fields = BasicFieldList<Allocator>;
+
+private:
+    friend class BasicHttpRequestTemplate<Allocator>;
+
+    // Immutable parts shared by every request made from one template
+    struct Prototype {
+        String url;
+        String method;
+        Fields headers;
+        Fields queryParams;
+        String body;
+    };
+
+    // Member variables
+    std::shared_ptr<const Prototype> prototype; // supplies url and method when set
+    String url;
+    String method;
+    Fields headers;
+    Fields queryParams;
+    String body;
+    std::shared_ptr<const BodyStream> stream; // replaces body when set
+
+    // Private constructor, only accessible from Builder; takes ownership of the parts
+    BasicHttpRequest(std::shared_ptr<const Prototype> prototype,
+                     String url,
+                     String method,
+                     Fields headers,
+                     Fields queryParams,
+                     String body,
+                     std::shared_ptr<const BodyStream> stream)
+        : prototype(std::move(prototype)), url(std::move(url)), method(std::move(method)),
+          headers(std::move(headers)), queryParams(std::move(queryParams)), body(std::move(body)),
+          stream(std::move(stream)) {}
+
+public:
+    // Getters
+    const String& getUrl() const { return prototype ? prototype->url : url; }
+    const String& getMethod() const { return prototype ? prototype->method : method; }
+    // Fields keep insertion order and header names ignore case; toMap() gives the former std::map view.
+    const Fields& getHeaders() const { return headers; }
+    const Fields& getQueryParams() const { return queryParams; }
+    std::optional<std::string_view> getHeader(std::string_view name) const { return headers.find(name); }
+    const String& getBody() const { return body; }
+    const BodyStream* getBodyStream() const { return stream.get(); } // null unless the body is streamed
+    Allocator get_allocator() const { return body.get_allocator(); }
+
+    /**
+     * Builder class for HttpRequest.
+     */
+    class Builder {
+    private:
+        friend class BasicHttpRequestTemplate<Allocator>;
+
+        std::shared_ptr<const Prototype> prototype; // set for builders made by a template
+        String url;
+        String method;
+        Fields headers;
+        Fields queryParams;
+        String body;
+        std::shared_ptr<const BodyStream> stream;
+
+        // Starts from a template: the fields are layered over the prototype's, and only the body is copied.
+        Builder(std::shared_ptr<const Prototype> shared, const Allocator& allocator)
+            : prototype(std::move(shared)), url(allocator), method(allocator),
+              headers(std::shared_ptr<const Fields>(prototype, &prototype->headers), allocator),
+              queryParams(std::shared_ptr<const Fields>(prototype, &prototype->queryParams), allocator),
+              body(prototype->body, allocator) {}
+
+        void validate() const {
+            if (url.empty()) {
+                throw std::invalid_argument("URL is Required");
+            }
+            if (method.empty()) {
+                throw std::invalid_argument("HTTP Method is Required");
+            }
+            // Both are written verbatim into the request line, so they must not be able to break out of it.
+            if (!FieldList::isToken(method)) {
+                throw std::invalid_argument("HTTP Method must be an RFC 9110 token");
+            }
+            if (HttpWire::hasSpaceOrControl(url)) {
+                throw std::invalid_argument("URL must not contain spaces or control characters");
+            }
+        }
+
+    public:
+        Builder(String url, String method)
+            : url(std::move(url)), method(std::move(method)),
+              headers(Fields::Names::CaseInsensitive, this->url.get_allocator()),
+              queryParams(Fields::Names::CaseSensitive, this->url.get_allocator()), body(this->url.get_allocator()) {
+            validate();
+        }
+
+        /**
+         * Starts a request whose every part is allocated from allocator.
+         */
+        Builder(std::string_view url, std::string_view method, const Allocator& allocator)
+            : url(url, allocator), method(method, allocator), headers(Fields::Names::CaseInsensitive, allocator),
+              queryParams(Fields::Names::CaseSensitive, allocator), body(allocator) {
+            validate();
+        }
+
+        Allocator get_allocator() const { return body.get_allocator(); }
+
+        // Each setter has an rvalue overload so a chain on a temporary Builder stays
+        // an rvalue and ends in the moving build().
+
+        /**
+         * Adds or replaces a header. Content-Length and Transfer-Encoding are written
+         * by the serializer from the body, so they cannot be set here.
+         * @throws std::invalid_argument if the name is not an RFC 9110 token or is a
+         *         framing header, or if the value holds CR or LF.
+         */
+        Builder& addHeader(std::string_view key, std::string_view value) & {
+            if (!FieldList::isToken(key)) {
+                throw std::invalid_argument("Header name must be a non-empty RFC 9110 token");
+            }
+            if (HttpWire::isFramingHeader(key)) {
+                throw std::invalid_argument("Content-Length and Transfer-Encoding are set from the body");
+            }
+            if (HttpWire::hasLineBreak(value)) {
+                throw std::invalid_argument("Header must not contain CR or LF");
+            }
+            headers.set(key, value);
+            return *this;
+        }
+
+        Builder&& addHeader(std::string_view key, std::string_view value) && {
+            return std::move(addHeader(key, value));
+        }
+
+        Builder& addQueryParam(std::string_view key, std::string_view value) & {
+            queryParams.set(key, value);
+            return *this;
+        }
+
+        Builder&& addQueryParam(std::string_view key, std::string_view value) && {
+            return std::move(addQueryParam(key, value));
+        }
+
+        Builder& setBody(const String& bodyContent) & {
+            body = bodyContent;
+            stream.reset();
+            return *this;
+        }
+
+        Builder& setBody(String&& bodyContent) & {
+            body = std::move(bodyContent);
+            stream.reset();
+            return *this;
+        }
+
+        /**
+         * Streams the body while the request is sent with sendTo() instead of holding it in memory.
+         */
+        Builder& setBody(BodyStream bodyStream) & {
+            body.clear();
+            stream = std::make_shared<const BodyStream>(std::move(bodyStream));
+            return *this;
+        }
+
+        Builder&& setBody(BodyStream bodyStream) && {
+            return std::move(setBody(std::move(bodyStream)));
+        }
+
+        Builder&& setBody(const String& bodyContent) && {
+            return std::move(setBody(bodyContent));
+        }
+
+        Builder&& setBody(String&& bodyContent) && {
+            return std::move(setBody(std::move(bodyContent)));
+        }
+
+        /**
+         * Builds a request from a copy of this builder's state, so the builder can be
+         * reused as a template for further requests.
+         */
+        BasicHttpRequest build() const& {
+            Allocator allocator = get_allocator();
+            return BasicHttpRequest(prototype, String(url, allocator), String(method, allocator), Fields(headers, allocator),
+                                    Fields(queryParams, allocator), String(body, allocator), stream);
+        }
+
+        /**
+         * Builds a request by moving this builder's state into it; nothing is copied,
+         * however large the body. The builder is left empty.
+         */
+        BasicHttpRequest build() && {
+            return BasicHttpRequest(std::move(prototype), std::move(url), std::move(method), std::move(headers),
+                                    std::move(queryParams), std::move(body), std::move(stream));
+        }
+
+        /**
+         * Freezes this builder's state into a template for requests that share it.
+         * @throws std::logic_error if the body is streamed, since a stream is read only once.
+         */
+        BasicHttpRequestTemplate<Allocator> freeze() const&;
+        BasicHttpRequestTemplate<Allocator> freeze() &&;
+    };
+
+    /**
+     * Builder whose method is a template argument and whose URL is tracked in its
+     * type: build() only compiles once url() has been called, so at run time only
+     * the URL, header names given as strings and header values are checked.
+     * Headers set through a HeaderName, such as KnownHeaders::ContentType, skip
+     * name checks and hashing. Each setter consumes the builder, so calls are chained:
+     *
+     *     HttpRequest::TypedBuilder<HttpMethod::Post>().url("https://api.example.com/users")
+     *         .header(KnownHeaders::ContentType, "application/json").body("{}").build();
+     */
+    template <HttpMethod Method, bool HasUrl = false>
+    class TypedBuilder {
+    public:
+        explicit TypedBuilder(const Allocator& allocator = Allocator())
+            : urlText(allocator), headers(Fields::Names::CaseInsensitive, allocator),
+              queryParams(Fields::Names::CaseSensitive, allocator), bodyText(allocator) {}
+
+        TypedBuilder<Method, true> url(std::string_view target) && {
+            static_assert(!HasUrl, "url() is already set");
+            if (HttpWire::hasSpaceOrControl(target)) {
+                throw std::invalid_argument("URL must not contain spaces or control characters");
+            }
+            urlText.assign(target.data(), target.size());
+            return TypedBuilder<Method, true>(std::move(*this));
+        }
+
+        TypedBuilder&& header(const HeaderName& name, std::string_view value) && {
+            if (HttpWire::isFramingHeader(name.name())) {
+                throw std::invalid_argument("Content-Length and Transfer-Encoding are set from the body");
+            }
+            checkValue(value);
+            headers.set(name, value);
+            return std::move(*this);
+        }
+
+        // Runtime names are checked like Builder::addHeader().
+        TypedBuilder&& header(std::string_view name, std::string_view value) && {
+            if (!FieldList::isToken(name)) {
+                throw std::invalid_argument("Header name must be a non-empty RFC 9110 token");
+            }
+            if (HttpWire::isFramingHeader(name)) {
+                throw std::invalid_argument("Content-Length and Transfer-Encoding are set from the body");
+            }
+            checkValue(value);
+            headers.set(name, value);
+            return std::move(*this);
+        }
+
+        TypedBuilder&& queryParam(std::string_view key, std::string_view value) && {
+            queryParams.set(key, value);
+            return std::move(*this);
+        }
+
+        TypedBuilder&& body(String content) && {
+            bodyText = std::move(content);
+            return std::move(*this);
+        }
+
+        TypedBuilder&& body(std::string_view content) && {
+            bodyText.assign(content.data(), content.size());
+            return std::move(*this);
+        }
+
+        TypedBuilder&& body(const char* content) && { return std::move(*this).body(std::string_view(content)); }
+
+        BasicHttpRequest build() && {
+            static_assert(HasUrl, "A request needs url() before build()");
+            String method(httpMethodName(Method), bodyText.get_allocator());
+            return BasicHttpRequest(nullptr, std::move(urlText), std::move(method), std::move(headers),
+                                    std::move(queryParams), std::move(bodyText), nullptr);
+        }
+
+    private:
+        template <HttpMethod, bool>
+        friend class TypedBuilder;
+
+        explicit TypedBuilder(TypedBuilder<Method, !HasUrl>&& other)
+            : urlText(std::move(other.urlText)), headers(std::move(other.headers)),
+              queryParams(std::move(other.queryParams)), bodyText(std::move(other.bodyText)) {}
+
+        static void checkValue(std::string_view value) {
+            if (HttpWire::hasLineBreak(value)) {
+                throw std::invalid_argument("Header must not contain CR or LF");
+            }
+        }
+
+        String urlText;
+        Fields headers;
+        Fields queryParams;
+        String bodyText;
+    };
+
+    /**
+     * Returns a human-readable representation of the HTTP request.
+     */
+    std::string toString() const {
+        std::ostringstream ss;
+        ss << getMethod() << " " << getUrl();
+
+        // Add query parameters if present
+        if (!queryParams.empty()) {
+            ss << "?";
+            bool first = true;
+            for (const auto& param : queryParams) {
+                if (!first) ss << "&";
+                ss << param.name << "=" << param.value;
+                first = false;
+            }
+        }
+
+        ss << "\n";
+
+        // Add headers
+        if (!headers.empty()) {
+            ss << "Headers:\n";
+            for (const auto& header : headers) {
+                ss << "  " << header.name << ": " << header.value << "\n";
+            }
+        }
+
+        // Add body
+        if (stream) {
+            ss << "Body:\n  <streamed, ";
+            if (stream->length()) {
+                ss << *stream->length() << " bytes>\n";
+            } else {
+                ss << "chunked>\n";
+            }
+        } else if (!body.empty()) {
+            ss << "Body:\n  " << body << "\n";
+        }
+
+        return ss.str();
+    }
+
+    /**
+     * @return The exact number of bytes sent for this request.
+     * @throws std::logic_error for a chunked body, whose size is not known in advance.
+     */
+    size_t wireSize() const {
+        std::optional<size_t> length = bodyLength();
+        if (!length) {
+            throw std::logic_error("A chunked body has no size until it is sent");
+        }
+        return headSize() + *length;
+    }
+
+    /**
+     * Sends the request to fd, a blocking socket, pipe or file. In-memory and mapped
+     * bodies go out with the head in one writev(); file bodies with sendfile().
+     * Generated bodies are produced and sent 16 KiB at a time, with chunked transfer
+     * encoding when their length is unknown, so memory use does not grow with the body.
+     * @throws std::system_error if writing fails, std::runtime_error if a stream ends early.
+     */
+    void sendTo(int fd) const {
+        String head(get_allocator());
+        head.resize(headSize());
+        writeHead(head.data());
+        if (stream) {
+            BodySender::send(fd, head, *stream);
+            return;
+        }
+        iovec parts[2] = {{head.data(), head.size()}, {const_cast<char*>(body.data()), body.size()}};
+        HttpWire::writeAll(fd, parts, body.empty() ? 1 : 2);
+    }
+
+    /**
+     * Appends the request in HTTP/1.1 wire format: request line, headers, blank line
+     * and body. Query parameters are percent-encoded; Host is added unless already
+     * set, and Content-Length always comes from the body. The exact size is computed
+     * first, so this allocates at most once, and not at all when a reused buffer
+     * already has room.
+     * @throws std::logic_error if the body is generated or read from a file; send those with sendTo().
+     */
+    template <typename Buffer>
+    void serializeTo(Buffer& out) const {
+        std::string_view content = memoryBody();
+        size_t start = out.size();
+        size_t head = headSize();
+        out.resize(start + head + content.size());
+        char* cursor = writeHead(out.data() + start);
+        HttpWire::put(cursor, content);
+    }
+
+    /**
+     * @return The request in HTTP/1.1 wire format, as serializeTo() writes it.
+     */
+    std::string toWire() const {
+        std::string out;
+        serializeTo(out);
+        return out;
+    }
+
+    /**
+     * The request as buffers for writev(): the head, then the body if there is one.
+     */
+    struct WireVectors {
+        std::array<iovec, 2> parts;
+        int count;    // parts in use
+        size_t bytes; // total across the parts
+    };
+
+    /**
+     * Writes only the request line and headers, into headBuffer, and references the
+     * body in place, so large bodies are sent without being copied.
+     * The vectors stay valid while both headBuffer and this request are unchanged.
+     * @throws std::logic_error if the body is generated or read from a file; send those with sendTo().
+     */
+    template <typename Buffer>
+    WireVectors toWireVectors(Buffer& headBuffer) const {
+        std::string_view content = memoryBody();
+        size_t head = headSize();
+        headBuffer.resize(head);
+        writeHead(headBuffer.data());
+        WireVectors vectors{};
+        vectors.parts[0] = {headBuffer.data(), head};
+        vectors.count = 1;
+        if (!content.empty()) {
+            vectors.parts[1] = {const_cast<char*>(content.data()), content.size()};
+            vectors.count = 2;
+        }
+        vectors.bytes = head + content.size();
+        return vectors;
+    }
+
+    /**
+     * Identity of the request for response caches, computed without building a key
+     * string and without allocating. It covers the method, the URL without its
+     * fragment (scheme and host case-insensitively), the query parameters in any order, and
+     * the values of varyHeaders, in the order given; a missing header differs from
+     * an empty one. Parameters written into the URL itself are hashed as text.
+     * Equal requests give equal fingerprints across processes for the same seed.
+     * Vary headers given as HeaderName tokens are found without hashing their names.
+     */
+    RequestFingerprint fingerprint(std::span<const HeaderName> varyHeaders = {},
+                                   uint64_t seed = FingerprintHasher::kDefaultSeed) const {
+        return fingerprintWith(varyHeaders, seed);
+    }
+
+    RequestFingerprint fingerprint(std::span<const std::string_view> varyHeaders,
+                                   uint64_t seed = FingerprintHasher::kDefaultSeed) const {
+        return fingerprintWith(varyHeaders, seed);
+    }
+
+private:
+    std::optional<size_t> bodyLength() const { return stream ? stream->length() : body.size(); }
+
+    template <typename Name>
+    RequestFingerprint fingerprintWith(std::span<const Name> varyHeaders, uint64_t seed) const {
+        std::string_view url = getUrl();
+        size_t schemeEnd = url.find("://");
+        HttpWire::Target target = HttpWire::splitUrl(url);
+        std::string_view path = target.path;
+        if (!path.empty() && path[0] == '/') {
+            path.remove_prefix(1); // "host" and "host/" name the same resource, as on the wire
+        }
+        FingerprintHasher hasher(seed);
+        hasher.add(getMethod());
+        hasher.add(url.substr(0, schemeEnd == std::string_view::npos ? 0 : schemeEnd), /*foldCase=*/true);
+        hasher.add(target.authority, /*foldCase=*/true);
+        hasher.add(path);
+        RequestFingerprint params;
+        for (FieldList::Field param : queryParams) {
+            FingerprintHasher field(seed);
+            field.add(param.name);
+            field.add(param.value);
+            params = FingerprintHasher::combineUnordered(params, field.finish());
+        }
+        hasher.addWord(queryParams.size());
+        hasher.add(params);
+        for (const Name& name : varyHeaders) {
+            std::optional<std::string_view> value = headers.find(name);
+            hasher.addWord(value.has_value());
+            hasher.add(value.value_or(std::string_view()));
+        }
+        return hasher.finish();
+    }
+
+    // The body when all of it is already in memory.
+    std::string_view memoryBody() const {
+        if (!stream) {
+            return body;
+        }
+        if (stream->kind() != BodyStream::Kind::Mapped) {
+            throw std::logic_error("Generated and file bodies are sent with sendTo()");
+        }
+        return stream->mapped();
+    }
+
+    // The builders reject caller-set framing headers, so these are the only ones written.
+    bool needsContentLength() const {
+        std::optional<size_t> length = bodyLength();
+        return length && *length > 0;
+    }
+
+    bool needsChunkedEncoding() const { return !bodyLength(); }
+
+    size_t headSize() const {
+        HttpWire::Target target = HttpWire::splitUrl(getUrl());
+        size_t size = getMethod().size() + 1 + target.needsLeadingSlash() + target.path.size() + 1 + HttpWire::kVersion.size() + 2;
+        for (size_t i = 0; i < queryParams.size(); ++i) {
+            FieldList::Field param = queryParams[i];
+            size += 2 + HttpWire::percentEncodedSize(param.name) + HttpWire::percentEncodedSize(param.value); // "?" or "&", "="
+        }
+        if (!target.authority.empty() && !headers.find("Host")) {
+            size += std::string_view("Host: \r\n").size() + target.authority.size();
+        }
+        for (FieldList::Field header : headers) {
+            size += header.name.size() + 2 + header.value.size() + 2;
+        }
+        if (needsContentLength()) {
+            size += std::string_view("Content-Length: \r\n").size() + HttpWire::decimalDigits(*bodyLength());
+        } else if (needsChunkedEncoding()) {
+            size += std::string_view("Transfer-Encoding: chunked\r\n").size();
+        }
+        return size + 2;
+    }
+
+    // Writes exactly headSize() bytes starting at out and returns the end.
+    char* writeHead(char* out) const {
+        HttpWire::Target target = HttpWire::splitUrl(getUrl());
+        out = HttpWire::put(out, getMethod());
+        *out++ = ' ';
+        if (target.needsLeadingSlash()) {
+            *out++ = '/';
+        }
+        out = HttpWire::put(out, target.path);
+        bool hasQuery = target.path.find('?') != std::string_view::npos;
+        for (size_t i = 0; i < queryParams.size(); ++i) {
+            FieldList::Field param = queryParams[i];
+            *out++ = hasQuery ? '&' : '?';
+            hasQuery = true;
+            out = HttpWire::percentEncode(param.name, out);
+            *out++ = '=';
+            out = HttpWire::percentEncode(param.value, out);
+        }
+        *out++ = ' ';
+        out = HttpWire::put(out, HttpWire::kVersion);
+        out = HttpWire::put(out, "\r\n");
+        if (!target.authority.empty() && !headers.find("Host")) {
+            out = HttpWire::put(out, "Host: ");
+            out = HttpWire::put(out, target.authority);
+            out = HttpWire::put(out, "\r\n");
+        }
+        for (FieldList::Field header : headers) {
+            out = HttpWire::put(out, header.name);
+            out = HttpWire::put(out, ": ");
+            out = HttpWire::put(out, header.value);
+            out = HttpWire::put(out, "\r\n");
+        }
+        if (needsContentLength()) {
+            size_t length = *bodyLength();
+            out = HttpWire::put(out, "Content-Length: ");
+            out = std::to_chars(out, out + HttpWire::decimalDigits(length), length).ptr;
+            out = HttpWire::put(out, "\r\n");
+        } else if (needsChunkedEncoding()) {
+            out = HttpWire::put(out, "Transfer-Encoding: chunked\r\n");
+        }
+        return HttpWire::put(out, "\r\n");
+    }
+};
+
+using HttpRequest = BasicHttpRequest<>;
+using PmrHttpRequest = BasicHttpRequest<std::pmr::polymorphic_allocator<char>>;
+
+/**
+ * Frozen request made with Builder::freeze(), for requests that share a URL,
+ * method and common headers or query parameters. Those parts are kept in one
+ * immutable, reference-counted block. Builders from request() layer their own
+ * headers and parameters over it and copy nothing from it but the body, so a
+ * request allocates only for what it overrides or adds.
+ * The block lives in memory from the freezing builder's allocator, which must
+ * outlast the template and every request made from it.
+ */
+template <typename Allocator = std::allocator<char>>
+class BasicHttpRequestTemplate {
+public:
+    using Request = BasicHttpRequest<Allocator>;
+
+    /**
+     * @return A builder that starts from this template's parts, allocating its own from allocator.
+     */
+    typename Request::Builder request(const Allocator& allocator) const { return typename Request::Builder(prototype, allocator); }
+    typename Request::Builder request() const { return request(prototype->body.get_allocator()); }
+
+private:
+    friend class Request::Builder;
+
+    explicit BasicHttpRequestTemplate(std::shared_ptr<const typename Request::Prototype> prototype)
+        : prototype(std::move(prototype)) {}
+
+    std::shared_ptr<const typename Request::Prototype> prototype;
+};
+
+using HttpRequestTemplate = BasicHttpRequestTemplate<>;
+using PmrHttpRequestTemplate = BasicHttpRequestTemplate<std::pmr::polymorphic_allocator<char>>;
+
+template <typename Allocator>
+BasicHttpRequestTemplate<Allocator> BasicHttpRequest<Allocator>::Builder::freeze() const& {
+    return Builder(*this).freeze();
+}
+
+template <typename Allocator>
+BasicHttpRequestTemplate<Allocator> BasicHttpRequest<Allocator>::Builder::freeze() && {
+    if (stream) {
+        throw std::logic_error("A streamed body cannot be part of a request template");
+    }
+    Allocator allocator = get_allocator();
+    auto frozen = std::allocate_shared<Prototype>(allocator, Prototype{
+        prototype ? String(prototype->url, allocator) : std::move(url),
+        prototype ? String(prototype->method, allocator) : std::move(method),
+        std::move(headers), // may stay layered over an earlier template
+        std::move(queryParams),
+        std::move(body),
+    });
+    prototype.reset();
+    return BasicHttpRequestTemplate<Allocator>(std::move(frozen));
+}
+
+/**
+ * Query parameter values for a batch, one column per parameter: request i of
+ * the batch gets name=values[i].
+ */
+struct QueryColumn {
+    std::string_view name;
+    std::span<const std::string_view> values;
+};
+
+/**
+ * Builds many requests from one template and serializes them in wire format in
+ * parallel. The batch is split into one contiguous range per thread; each thread
+ * writes its range back to back into a buffer it keeps between batches, so a
+ * steady stream of batches stops allocating output space. Requests from a
+ * PmrHttpRequestTemplate are also built in a per-thread arena released after
+ * each request. The outputs come back as one iovec per thread, in request order,
+ * ready for a single writev() or io_uring write.
+ * One batch runs at a time; serialize() must not be called concurrently.
+ */
+class BatchSerializer {
+public:
+    /**
+     * The serialized batch. It refers to the serializer's buffers and is valid
+     * until the next serialize() call or the serializer's destruction.
+     */
+    class Result {
+    public:
+        size_t size() const { return owner->ends.size(); }
+
+        // Wire bytes of request i.
+        std::string_view operator[](size_t index) const {
+            size_t worker = size_t(std::upper_bound(owner->rangeBegins.begin(), owner->rangeBegins.end(), index) -
+                                   owner->rangeBegins.begin()) - 1;
+            size_t start = index == owner->rangeBegins[worker] ? 0 : owner->ends[index - 1];
+            return std::string_view(owner->workers[worker]->buffer.data() + start, owner->ends[index] - start);
+        }
+
+        std::span<const iovec> vectors() const { return owner->vectors; }
+        size_t bytes() const { return owner->totalBytes; }
+
+    private:
+        friend class BatchSerializer;
+        explicit Result(const BatchSerializer* owner) : owner(owner) {}
+        const BatchSerializer* owner;
+    };
+
+    explicit BatchSerializer(size_t threadCount = std::max(1u, std::thread::hardware_concurrency())) {
+        if (threadCount == 0) {
+            throw std::invalid_argument("Batch serializer needs at least one thread");
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        // The calling thread serves as worker 0.
+        for (size_t i = 1; i < threadCount; ++i) {
+            threads.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    BatchSerializer(const BatchSerializer&) = delete;
+    BatchSerializer& operator=(const BatchSerializer&) = delete;
+
+    ~BatchSerializer() {
+        {
+            std::lock_guard<std::mutex> lock(batchMutex);
+            stopping = true;
+        }
+        batchReady.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    size_t threadCount() const { return workers.size(); }
+
+    /**
+     * Serializes one request per row of columns: common's request with every
+     * column's parameter added, as serializeTo() would write it.
+     * @throws std::invalid_argument if the columns differ in length; anything a
+     * request throws while being built or serialized is rethrown here.
+     */
+    template <typename Allocator>
+    Result serialize(const BasicHttpRequestTemplate<Allocator>& common, std::span<const QueryColumn> columns) {
+        size_t count = columns.empty() ? 0 : columns[0].values.size();
+        for (const QueryColumn& column : columns) {
+            if (column.values.size() != count) {
+                throw std::invalid_argument("Every query column needs one value per request");
+            }
+        }
+        ends.resize(count);
+        rangeBegins.resize(workers.size());
+        for (size_t i = 0; i < workers.size(); ++i) {
+            rangeBegins[i] = count * i / workers.size();
+        }
+        run([&](size_t worker) {
+            size_t begin = rangeBegins[worker];
+            size_t end = worker + 1 < workers.size() ? rangeBegins[worker + 1] : count;
+            serializeRange(common, columns, begin, end, *workers[worker]);
+        });
+        vectors.clear();
+        totalBytes = 0;
+        for (const std::unique_ptr<Worker>& worker : workers) {
+            if (!worker->buffer.empty()) {
+                vectors.push_back({worker->buffer.data(), worker->buffer.size()});
+                totalBytes += worker->buffer.size();
+            }
+        }
+        return Result(this);
+    }
+
+private:
+    static constexpr size_t kArenaBytes = 16 * 1024;
+
+    // Per-thread state kept between batches; cache-line aligned so threads do not share lines.
+    struct alignas(64) Worker {
+        std::string buffer;
+        std::unique_ptr<std::byte[]> scratch = std::make_unique<std::byte[]>(kArenaBytes);
+        std::pmr::monotonic_buffer_resource arena{scratch.get(), kArenaBytes};
+        std::exception_ptr error;
+    };
+
+    template <typename Allocator>
+    void serializeRange(const BasicHttpRequestTemplate<Allocator>& common, std::span<const QueryColumn> columns,
+                        size_t begin, size_t end, Worker& worker) {
+        constexpr bool usesArena = std::is_same_v<Allocator, std::pmr::polymorphic_allocator<char>>;
+        worker.buffer.clear();
+        // Releases the arena after each request, also when one throws, so its upstream
+        // blocks cannot pile up; declared before the builder, so it runs after the builder is gone.
+        struct ArenaRelease {
+            std::pmr::monotonic_buffer_resource* arena;
+            ~ArenaRelease() {
+                if (arena) {
+                    arena->release();
+                }
+            }
+        };
+        for (size_t i = begin; i < end; ++i) {
+            {
+                ArenaRelease release{usesArena ? &worker.arena : nullptr};
+                typename BasicHttpRequest<Allocator>::Builder builder = [&] {
+                    if constexpr (usesArena) {
+                        return common.request(Allocator(&worker.arena));
+                    } else {
+                        return common.request();
+                    }
+                }();
+                for (const QueryColumn& column : columns) {
+                    builder.addQueryParam(column.name, column.values[i]);
+                }
+                std::move(builder).build().serializeTo(worker.buffer);
+            }
+            ends[i] = worker.buffer.size();
+        }
+    }
+
+    // Runs job(worker) once for every worker, the caller taking worker 0, and waits for all of them.
+    void run(const std::function<void(size_t)>& job) {
+        {
+            std::lock_guard<std::mutex> lock(batchMutex);
+            currentJob = &job;
+            running = threads.size();
+            ++generation;
+        }
+        batchReady.notify_all();
+        runShare(0);
+        {
+            std::unique_lock<std::mutex> lock(batchMutex);
+            batchDone.wait(lock, [this] { return running == 0; });
+            currentJob = nullptr;
+        }
+        // Clear every worker's error, so none is left to surface from a later batch.
+        std::exception_ptr first;
+        for (const std::unique_ptr<Worker>& worker : workers) {
+            std::exception_ptr error = std::exchange(worker->error, nullptr);
+            if (error && !first) {
+                first = std::move(error);
+            }
+        }
+        if (first) {
+            std::rethrow_exception(first);
+        }
+    }
+
+    void runShare(size_t worker) {
+        try {
+            (*currentJob)(worker);
+        } catch (...) {
+            workers[worker]->buffer.clear();
+            workers[worker]->error = std::current_exception();
+        }
+    }
+
+    void workerLoop(size_t worker) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(batchMutex);
+        for (;;) {
+            batchReady.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            lock.unlock();
+            runShare(worker);
+            lock.lock();
+            if (--running == 0) {
+                batchDone.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads; // workers 1 and up
+    std::vector<size_t> rangeBegins;  // first request of each worker's range
+    std::vector<size_t> ends;         // end of each request within its worker's buffer
+    std::vector<iovec> vectors;
+    size_t totalBytes = 0;
+
+    std::mutex batchMutex;
+    std::condition_variable batchReady;
+    std::condition_variable batchDone;
+    const std::function<void(size_t)>* currentJob = nullptr;
+    uint64_t generation = 0;
+    size_t running = 0; // threads still working on the current batch
+    bool stopping = false;
+};
+
+/**
+ * HTTP request parsed in place: every part is a view into the buffer it was
+ * parsed from, so it is valid only while that buffer is unchanged.
+ * The getters mirror HttpRequest's; query parameters are still percent-encoded.
+ * Use toRequest() for an owning copy.
+ */
+class HttpRequestView {
+public:
+    std::string_view getUrl() const { return url; } // request target without its query string
+    std::string_view getMethod() const { return method; }
+    std::string_view getVersion() const { return version; }
+    const FieldViews& getHeaders() const { return headers; }
+    const FieldViews& getQueryParams() const { return queryParams; }
+    std::string_view getBody() const { return body; }
+    std::optional<std::string_view> getHeader(std::string_view name) const { return headers.find(name); }
+
+    /**
+     * Copies the request into an owning request allocated from allocator, decoding
+     * the query parameters.
+     */
+    template <typename Allocator = std::allocator<char>>
+    BasicHttpRequest<Allocator> toRequest(const Allocator& allocator = Allocator()) const {
+        using Request = BasicHttpRequest<Allocator>;
+        typename Request::Builder builder(url, method, allocator);
+        for (const FieldViews::Field& header : headers) {
+            // The parser checked Content-Length against the body; the serializer writes it again.
+            if (!HttpWire::isFramingHeader(header.name)) {
+                builder.addHeader(header.name, header.value);
+            }
+        }
+        for (const FieldViews::Field& param : queryParams) {
+            builder.addQueryParam(HttpWire::percentDecode(param.name), HttpWire::percentDecode(param.value));
+        }
+        return std::move(builder).setBody(typename Request::String(body, allocator)).build();
+    }
+
+private:
+    friend class HttpRequestParser;
+
+    std::string_view url;
+    std::string_view method;
+    std::string_view version;
+    FieldViews headers{FieldList::Names::CaseInsensitive};
+    FieldViews queryParams;
+    std::string_view body;
+};
+
+/**
+ * Incremental HTTP/1.1 request parser that allocates nothing for requests with
+ * up to 16 headers and 16 query parameters.
+ * Call parse() with everything received so far each time more bytes arrive;
+ * the buffer may move between calls (for example when a std::string grows) as
+ * long as its earlier bytes are unchanged. Lines already scanned are not scanned
+ * again. Once parse() returns Done, view() refers into the buffer last passed.
+ * Bodies must be sized by Content-Length; chunked request bodies are rejected.
+ * Anything HttpRequest's builders would reject fails to parse, so a request that
+ * parsed as Done always converts through view().toRequest().
+ */
+class HttpRequestParser {
+public:
+    enum class Status {
+        NeedMore, // the request is incomplete; call parse() again with more bytes
+        Done,     // view() holds the request; consumed() bytes belong to it
+        Error     // the request is malformed; see error()
+    };
+
+    static constexpr size_t kMaxHeadBytes = 64 * 1024; // request line and headers
+
+    Status parse(std::string_view buffer) {
+        while (state == State::RequestLine || state == State::Headers) {
+            const char* begin = buffer.data();
+            const char* limit = begin + std::min(buffer.size(), kMaxHeadBytes);
+            const char* newline = HttpWire::findByte(begin + cursor, limit, '\n');
+            if (newline == limit) {
+                cursor = size_t(limit - begin);
+                return buffer.size() >= kMaxHeadBytes ? fail("request head too large") : Status::NeedMore;
+            }
+            size_t lineEnd = size_t(newline - begin);
+            if (lineEnd == lineStart || begin[lineEnd - 1] != '\r') {
+                return fail("line not terminated by CRLF");
+            }
+            std::string_view line = buffer.substr(lineStart, lineEnd - 1 - lineStart);
+            lineStart = cursor = lineEnd + 1;
+            if (state == State::RequestLine) {
+                if (!parseRequestLine(line, buffer.data())) {
+                    return Status::Error;
+                }
+                state = State::Headers;
+            } else if (line.empty()) {
+                headEnd = lineStart;
+                state = State::Body;
+            } else if (!parseHeader(line, buffer.data())) {
+                return Status::Error;
+            }
+        }
+        if (state == State::Body) {
+            if (buffer.size() - headEnd < bodyLength) {
+                return Status::NeedMore;
+            }
+            finish(buffer);
+            state = State::Done;
+        }
+        return state == State::Done ? Status::Done : Status::Error;
+    }
+
+    const HttpRequestView& view() const { return request; }
+
+    // Bytes of the buffer taken by the parsed request; any bytes after it belong to the next one.
+    size_t consumed() const { return headEnd + bodyLength; }
+
+    const char* error() const { return errorMessage; }
+
+    // Prepares the parser for the next request.
+    void reset() { *this = HttpRequestParser(); }
+
+private:
+    enum class State { RequestLine, Headers, Body, Done, Error };
+
+    struct Span {
+        uint32_t offset; // into the buffer
+        uint32_t length;
+    };
+
+    struct HeaderSpan {
+        Span name;
+        Span value;
+    };
+
+    static Span spanOf(std::string_view part, const char* base) {
+        return {uint32_t(part.data() - base), uint32_t(part.size())};
+    }
+
+    static std::string_view viewOf(Span span, std::string_view buffer) {
+        return buffer.substr(span.offset, span.length);
+    }
+
+    static bool isWhitespace(char c) { return c == ' ' || c == '\t'; }
+
+    Status fail(const char* message) {
+        state = State::Error;
+        errorMessage = message;
+        return Status::Error;
+    }
+
+    bool parseRequestLine(std::string_view line, const char* base) {
+        size_t methodEnd = line.find(' ');
+        size_t targetEnd = methodEnd == std::string_view::npos ? methodEnd : line.find(' ', methodEnd + 1);
+        if (methodEnd == 0 || targetEnd == std::string_view::npos || targetEnd == methodEnd + 1 ||
+            line[methodEnd + 1] == '?' || // the path before the query becomes the URL, which must not be empty
+            !FieldList::isToken(line.substr(0, methodEnd)) ||
+            HttpWire::hasSpaceOrControl(line.substr(methodEnd + 1, targetEnd - methodEnd - 1))) {
+            fail("malformed request line");
+            return false;
+        }
+        std::string_view version = line.substr(targetEnd + 1);
+        if (version != "HTTP/1.1" && version != "HTTP/1.0") {
+            fail("unsupported HTTP version");
+            return false;
+        }
+        method = spanOf(line.substr(0, methodEnd), base);
+        target = spanOf(line.substr(methodEnd + 1, targetEnd - methodEnd - 1), base);
+        this->version = spanOf(version, base);
+        return true;
+    }
+
+    bool parseHeader(std::string_view line, const char* base) {
+        if (isWhitespace(line.front())) {
+            fail("obsolete header line folding");
+            return false;
+        }
+        const char* colon = HttpWire::findByte(line.data(), line.data() + line.size(), ':');
+        std::string_view name = line.substr(0, size_t(colon - line.data()));
+        if (colon == line.data() + line.size() || !FieldList::isToken(name)) {
+            fail("malformed header");
+            return false;
+        }
+        std::string_view value = line.substr(name.size() + 1);
+        while (!value.empty() && isWhitespace(value.front())) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && isWhitespace(value.back())) {
+            value.remove_suffix(1);
+        }
+        // A bare CR, NUL or other control byte would not survive toRequest(); RFC 9112 allows rejecting it.
+        if (HttpWire::hasFieldControl(value)) {
+            fail("invalid header value");
+            return false;
+        }
+        if (FieldList::equalIgnoringCase(name, "Content-Length")) {
+            size_t length = 0;
+            auto [end, status] = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (value.empty() || status != std::errc() || end != value.data() + value.size() ||
+                (hasContentLength && length != bodyLength)) {
+                fail("invalid Content-Length");
+                return false;
+            }
+            hasContentLength = true;
+            bodyLength = length;
+        } else if (FieldList::equalIgnoringCase(name, "Transfer-Encoding")) {
+            fail("Transfer-Encoding request bodies are not supported");
+            return false;
+        }
+        headerSpans.push_back({spanOf(name, base), spanOf(value, base)});
+        return true;
+    }
+
+    // Builds the view against the final buffer, splitting the query string into parameters.
+    void finish(std::string_view buffer) {
+        std::string_view fullTarget = viewOf(target, buffer);
+        size_t queryStart = fullTarget.find('?');
+        request.url = fullTarget.substr(0, queryStart);
+        request.method = viewOf(method, buffer);
+        request.version = viewOf(version, buffer);
+        request.body = buffer.substr(headEnd, bodyLength);
+        for (size_t i = 0; i < headerSpans.size(); ++i) {
+            request.headers.add(viewOf(headerSpans[i].name, buffer), viewOf(headerSpans[i].value, buffer));
+        }
+        if (queryStart == std::string_view::npos) {
+            return;
+        }
+        std::string_view query = fullTarget.substr(queryStart + 1);
+        while (!query.empty()) {
+            std::string_view pair = query.substr(0, query.find('&'));
+            query.remove_prefix(std::min(pair.size() + 1, query.size()));
+            if (pair.empty()) {
+                continue;
+            }
+            size_t equals = pair.find('=');
+            request.queryParams.add(pair.substr(0, equals),
+                                    equals == std::string_view::npos ? std::string_view() : pair.substr(equals + 1));
+        }
+    }
+
+    State state = State::RequestLine;
+    size_t lineStart = 0; // where the line being scanned begins
+    size_t cursor = 0;    // where scanning for its end resumes
+    size_t headEnd = 0;
+    size_t bodyLength = 0;
+    bool hasContentLength = false;
+    Span method{};
+    Span target{};
+    Span version{};
+    SmallVector<HeaderSpan, 32> headerSpans;
+    HttpRequestView request;
+    const char* errorMessage = "";
+};
@@ -1,114 +1,23 @@
-#include <iostream>
-#include <string>
-using namespace std;
+#include "FactoryPattern.hpp"
 
-/**
- * Interface representing a general payment method.
- * All concrete payment methods will implement this interface.
- */
-class PaymentMethod {
-public:
-    /**
-     * Processes the payment of a specified amount.
-     * 
-     * @param amount The amount to be paid.
-     */
-    virtual void pay(double amount) = 0;
-
-    // Virtual destructor to ensure proper cleanup of derived classes.
-    virtual ~PaymentMethod() {}
-};
-
-/**
- * Concrete implementation of the PaymentMethod interface for CreditCard payments.
- */
-class CreditCard : public PaymentMethod {
-public:
-    /**
-     * Processes the payment through a credit card.
-     * 
-     * @param amount The amount to be paid using a credit card.
-     */
-    void pay(double amount) override {
-        // Simulate calling the API for credit card payment processing
-        cout << "Payment Processing from Credit Card for amount = " << amount << endl;
-    }
-};
+#include <future>
+#include <memory>
 
 /**
- * Concrete implementation of the PaymentMethod interface for DebitCard payments.
+ * Example of a payment method defined outside the factory and registered at runtime.
  */
-class DebitCard : public PaymentMethod {
+class Wallet final : public PaymentMethod {
 public:
-    /**
-     * Processes the payment through a debit card.
-     * 
-     * @param amount The amount to be paid using a debit card.
-     */
-    void pay(double amount) override {
-        // Simulate calling the API for debit card payment processing
-        cout << "Payment Processing for Debit Card for amount = " << amount << endl;
-    }
-};
+    using PaymentMethod::pay; // the Money overload converts to pay(double)
 
-/**
- * Concrete implementation of the PaymentMethod interface for UPI (Unified Payments Interface) payments.
- */
-class UPI : public PaymentMethod {
-public:
     /**
-     * Processes the payment through UPI.
+     * Processes the payment through a digital wallet.
      * 
-     * @param amount The amount to be paid using UPI.
+     * @param amount The amount to be paid from the wallet.
      */
     void pay(double amount) override {
-        // Simulate calling the API for UPI payment processing
-        cout << "Payment Processing for UPI for amount = " << amount << endl;
-    }
-};
-
-/**
- * Concrete implementation of the PaymentMethod interface for NetBanking payments.
- */
-class NetBanking : public PaymentMethod {
-public:
-    /**
-     * Processes the payment through NetBanking.
-     * 
-     * @param amount The amount to be paid using NetBanking.
-     */
-    void pay(double amount) override {
-        // Simulate calling the API for NetBanking payment processing
-        cout << "Payment Processing for NetBanking for amount = " << amount << endl;
-    }
-};
-
-/**
- * Factory class responsible for creating instances of different PaymentMethod implementations.
- * This class follows the Factory design pattern.
- */
-class PaymentFactory {
-public:
-    /**
-     * Creates and returns an instance of a PaymentMethod based on the provided mode.
-     * 
-     * @param mode The payment mode (e.g., "creditcard", "debitcard", "upi", "netbanking").
-     * @return A concrete implementation of PaymentMethod corresponding to the mode.
-     *         Returns nullptr if the mode is unrecognized.
-     */
-    static PaymentMethod* createPayment(const string& mode) {
-        // Return appropriate PaymentMethod object based on the payment mode.
-        if (mode == "creditcard") {
-            return new CreditCard();  // Return CreditCard object.
-        } else if (mode == "debitcard") {
-            return new DebitCard();   // Return DebitCard object.
-        } else if (mode == "upi") {
-            return new UPI();         // Return UPI object.
-        } else if (mode == "netbanking") {
-            return new NetBanking();  // Return NetBanking object.
-        } else {
-            return nullptr;  // Return nullptr if the mode is invalid or unrecognized.
-        }
+        // Simulate calling the API for wallet payment processing
+        PaymentLog::instance().log("Payment Processing for Wallet for amount = ", amount);
     }
 };
 
@@ -125,12 +34,51 @@ int main() {
         delete paymentMethod; // Clean up the created object.
     }
 
-    // Create a PaymentMethod instance for UPI and process a payment.
-    paymentMethod = PaymentFactory::createPayment("upi");
+    // Create a PaymentMethod instance for UPI directly from its enum and process a payment.
+    paymentMethod = PaymentFactory::createPayment(PaymentMode::UPI);
     if (paymentMethod != nullptr) {
         paymentMethod->pay(343.24); // Process payment of amount 343.24 using UPI.
         delete paymentMethod; // Clean up the created object.
     }
 
+    // Stateless methods can be shared instead of allocated; nothing to delete afterwards.
+    PaymentFactory::sharedPayment(PaymentMode::NetBanking).pay(57.10);
+
+    // Within the built-in methods, a variant held by value pays without a virtual call.
+    PaymentVariant debit = PaymentFactory::createPaymentVariant(PaymentMode::DebitCard);
+    pay(debit, 18.75);
+
+    // A batch pays each method once for all of its records.
+    PaymentRecord settlement[] = {
+        {PaymentMode::UPI, 120.00}, {PaymentMode::CreditCard, 45.50},
+        {PaymentMode::UPI, 80.25}, {PaymentMode::CreditCard, 19.99}, {PaymentMode::NetBanking, 300.00}, {PaymentMode::NetBanking, 42.00},
+    };
+    PaymentBatch batch;
+    batch.process(settlement);
+
+    // Exact amounts in minor units avoid floating-point rounding end to end.
+    PaymentFactory::sharedPayment(PaymentMode::CreditCard).pay(Money{10222, Currency::INR});
+    MoneyRecord exactSettlement[] = {
+        {PaymentMode::UPI, 12000}, {PaymentMode::DebitCard, 1999}, {PaymentMode::UPI, 8025}, {PaymentMode::DebitCard, 501},
+    };
+    batch.process(exactSettlement, Currency::INR);
+
+    // Payments can run on a thread pool; the futures report when each one is done.
+    AsyncPaymentEngine engine(/*threadCount=*/2, /*windowPerMethod=*/2);
+    std::future<void> receipt = engine.pay(PaymentMode::CreditCard, 250.00);
+    receipt.get();
+    PaymentLog::instance().flush(); // the pool thread's message comes before anything logged below
+
+    // New modes are registered at runtime; the factory finds them without being edited.
+    PaymentRegistry::global().registerMethod("wallet", [] { return std::make_unique<Wallet>(); });
+    paymentMethod = PaymentFactory::createPayment("wallet");
+    if (paymentMethod != nullptr) {
+        paymentMethod->pay(75.00);
+        delete paymentMethod;
+    }
+
+    // Payment messages are written in the background; flush before exiting or printing elsewhere.
+    PaymentLog::instance().flush();
+
     return 0;
 }
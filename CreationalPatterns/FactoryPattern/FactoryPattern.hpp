@@ -0,0 +1,1324 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <variant>
+#include <vector>
+#include <span>
+#include <array>
+#include <stdexcept>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <semaphore>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <charconv>
+#include <cerrno>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Fixed-size thread pool with one task queue per worker.
+ * A worker runs tasks from the back of its own queue and, once that is empty,
+ * steals from the front of the others, so a burst submitted to one queue still
+ * spreads across every thread. Tasks submitted from outside the pool are dealt
+ * to the queues round-robin; tasks submitted by a worker go to its own queue.
+ */
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t threadCount = std::max(1u, std::thread::hardware_concurrency())) {
+        if (threadCount == 0) {
+            throw std::invalid_argument("Thread pool needs at least one thread");
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Runs every task already submitted, then stops the workers.
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * Queues a task to run on one of the pool's threads.
+     * @return A future for the task's result; it rethrows anything the task throws.
+     */
+    template <typename Fn>
+    std::future<std::invoke_result_t<std::decay_t<Fn>>> submit(Fn&& fn) {
+        using Result = std::invoke_result_t<std::decay_t<Fn>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        std::future<Result> result = task->get_future();
+        size_t target = currentPool == this ? currentWorker : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        // Count the task before publishing it, so a worker that takes it at once
+        // never decrements pending below zero.
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            ++pending;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->queueMutex);
+            queues[target]->tasks.emplace_back([task] { (*task)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+
+    size_t threadCount() const { return workers.size(); }
+
+private:
+    struct Queue {
+        std::mutex queueMutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Takes the newest task from the worker's own queue, or steals the oldest from another.
+    bool tryTake(size_t self, std::function<void()>& task) {
+        for (size_t offset = 0; offset < queues.size(); ++offset) {
+            Queue& queue = *queues[(self + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.queueMutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (offset == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(size_t self) {
+        currentPool = this;
+        currentWorker = self;
+        for (;;) {
+            std::function<void()> task;
+            if (tryTake(self, task)) {
+                {
+                    std::lock_guard<std::mutex> lock(sleepMutex);
+                    --pending;
+                }
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || pending > 0; });
+            if (stopping && pending == 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> nextQueue{0};
+
+    std::mutex sleepMutex; // guards pending and stopping; idle workers wait on wake
+    std::condition_variable wake;
+    size_t pending = 0; // tasks submitted but not yet taken
+    bool stopping = false;
+
+    static inline thread_local WorkStealingPool* currentPool = nullptr;
+    static inline thread_local size_t currentWorker = 0;
+};
+
+/**
+ * Caps how many payments of one method are in flight at once.
+ * Submitting blocks while the window is full, which pushes back on the caller
+ * instead of letting queued payments grow without bound.
+ */
+class InFlightWindow {
+public:
+    explicit InFlightWindow(ptrdiff_t limit) : slots(limit) {
+        if (limit <= 0) {
+            throw std::invalid_argument("In-flight window must allow at least one payment");
+        }
+    }
+
+    void acquire() { slots.acquire(); }
+    void release() { slots.release(); }
+
+private:
+    std::counting_semaphore<> slots;
+};
+
+/**
+ * Currencies that payments can be made in.
+ */
+enum class Currency : uint8_t {
+    INR,
+    USD,
+    EUR
+};
+
+inline constexpr const char* currencyCode(Currency currency) {
+    switch (currency) {
+        case Currency::INR: return "INR";
+        case Currency::USD: return "USD";
+        case Currency::EUR: return "EUR";
+    }
+    return "???";
+}
+
+/**
+ * Exact amount of money in minor units (paise, cents) tagged with its currency.
+ * Every supported currency has 100 minor units per major unit.
+ */
+struct Money {
+    static constexpr int64_t kMinorPerMajor = 100;
+
+    int64_t minorUnits = 0;
+    Currency currency = Currency::INR;
+
+    /**
+     * Rounds an amount in major units to the nearest minor unit (e.g., 102.22 -> 10222).
+     * @throws std::invalid_argument if the amount is NaN, infinite or outside the int64_t range.
+     */
+    static Money fromMajor(double amount, Currency currency) {
+        double minor = amount * double(kMinorPerMajor);
+        constexpr double kLimit = 9223372036854775808.0; // 2^63, exact as a double
+        if (!std::isfinite(minor) || minor < -kLimit || minor >= kLimit) {
+            throw std::invalid_argument("Amount is not a representable number of minor units");
+        }
+        return Money{std::llround(minor), currency};
+    }
+
+    double toMajor() const { return double(minorUnits) / double(kMinorPerMajor); }
+};
+
+// Largest single payment the batch API accepts: 10^12 minor units.
+inline constexpr int64_t kMaxPaymentMinorUnits = 1000000000000;
+
+/**
+ * Checks that every amount is positive and at most kMaxPaymentMinorUnits.
+ * The scan is branch-free so the compiler can vectorize it; only a failed check
+ * goes back to find the first bad amount.
+ *
+ * @param amounts Amounts in minor units.
+ * @throws invalid_argument naming the index of the first invalid amount.
+ */
+inline void validateMinorUnits(std::span<const int64_t> amounts) {
+    bool valid = true;
+    for (int64_t amount : amounts) {
+        valid &= (amount > 0) & (amount <= kMaxPaymentMinorUnits);
+    }
+    if (valid) {
+        return;
+    }
+    for (size_t i = 0; i < amounts.size(); ++i) {
+        if (amounts[i] <= 0 || amounts[i] > kMaxPaymentMinorUnits) {
+            throw std::invalid_argument("Invalid payment amount at index " + std::to_string(i));
+        }
+    }
+}
+
+/**
+ * Sums amounts that passed validateMinorUnits() exactly.
+ * Works in chunks short enough that no chunk can overflow, so the inner loop is a
+ * plain vectorizable integer sum and only chunk totals are checked for overflow.
+ *
+ * @param amounts Validated amounts in minor units.
+ * @return The total in minor units.
+ * @throws overflow_error if the total does not fit in 64 bits.
+ */
+inline int64_t sumMinorUnits(std::span<const int64_t> amounts) {
+    constexpr size_t kChunk = size_t(1) << 20; // 2^20 * 10^12 < 2^63
+    int64_t total = 0;
+    for (size_t start = 0; start < amounts.size(); start += kChunk) {
+        size_t end = std::min(amounts.size(), start + kChunk);
+        int64_t chunk = 0;
+        for (size_t i = start; i < end; ++i) {
+            chunk += amounts[i];
+        }
+        if (__builtin_add_overflow(total, chunk, &total)) {
+            throw std::overflow_error("Payment total does not fit in 64 bits");
+        }
+    }
+    return total;
+}
+
+/**
+ * Validates and sums amounts in a single pass over memory, for totals over arrays
+ * too large to stay in cache, where a separate validation pass would double the
+ * memory traffic.
+ *
+ * @param amounts Amounts in minor units.
+ * @return The total in minor units.
+ * @throws invalid_argument naming the index of the first invalid amount.
+ */
+inline int64_t checkedSumMinorUnits(std::span<const int64_t> amounts) {
+    constexpr size_t kChunk = size_t(1) << 20; // 2^20 * 10^12 < 2^63
+    int64_t total = 0;
+    for (size_t start = 0; start < amounts.size(); start += kChunk) {
+        std::span<const int64_t> chunk = amounts.subspan(start, std::min(kChunk, amounts.size() - start));
+        bool valid = true;
+        uint64_t sum = 0; // unsigned, so invalid amounts wrap harmlessly until the chunk is rejected
+        for (int64_t amount : chunk) {
+            valid &= (amount > 0) & (amount <= kMaxPaymentMinorUnits);
+            sum += uint64_t(amount);
+        }
+        if (!valid) {
+            validateMinorUnits(amounts); // finds and reports the first bad amount
+        }
+        if (__builtin_add_overflow(total, int64_t(sum), &total)) {
+            throw std::overflow_error("Payment total does not fit in 64 bits");
+        }
+    }
+    return total;
+}
+
+/**
+ * Asynchronous log sink for payment messages.
+ * Each thread appends fixed-size binary records to its own lock-free ring, so
+ * logging takes no lock and does no formatting or I/O on the caller's thread.
+ * A background thread drains every ring, formats the numbers and writes the
+ * text with one write(2) per batch. Nothing is flushed per message: output
+ * reaches the file descriptor as soon as the drain thread gets to it, or before
+ * flush() returns. An idle drain thread sleeps until a ring goes from empty to
+ * non-empty, so an idle log costs no wake-ups.
+ * Messages from one thread keep their order; messages from different threads are
+ * only ordered by flush().
+ * Message text must be string literals (or otherwise outlive the log), since
+ * only the pointer is recorded.
+ */
+class PaymentLog {
+public:
+    static PaymentLog& instance() {
+        static PaymentLog log;
+        return log;
+    }
+
+    PaymentLog(const PaymentLog&) = delete;
+    PaymentLog& operator=(const PaymentLog&) = delete;
+
+    // Logs "<text><amount>".
+    void log(const char* text, double amount) {
+        append(Record{text, nullptr, amount, 0, 0, nullptr});
+    }
+
+    // Logs "<text><count><middle><amount>".
+    void log(const char* text, uint64_t count, const char* middle, double amount) {
+        append(Record{text, middle, amount, count, 0, nullptr});
+    }
+
+    // Logs "<text><amount> <currency>", e.g. "... = 102.22 INR".
+    void log(const char* text, Money amount) {
+        append(Record{text, nullptr, 0, 0, amount.minorUnits, currencyCode(amount.currency)});
+    }
+
+    // Logs "<text><count><middle><amount> <currency>".
+    void log(const char* text, uint64_t count, const char* middle, Money amount) {
+        append(Record{text, middle, 0, count, amount.minorUnits, currencyCode(amount.currency)});
+    }
+
+    /**
+     * Blocks until every message this thread logged before the call has been written.
+     */
+    void flush() {
+        std::unique_lock<std::mutex> lock(flushMutex);
+        uint64_t ticket = ++flushRequested;
+        wake();
+        flushed.wait(lock, [&] { return flushedThrough >= ticket; });
+    }
+
+    /**
+     * Sends later output to another file descriptor (e.g., /dev/null in benchmarks).
+     * Messages already logged are flushed to the old descriptor first.
+     * @return The previous descriptor.
+     */
+    int redirect(int fd) {
+        flush();
+        return outputFd.exchange(fd);
+    }
+
+private:
+    struct Record {
+        const char* text;
+        const char* middle; // nullptr for single-amount messages
+        double amount;
+        uint64_t count;
+        int64_t minorUnits;
+        const char* currency; // set for Money amounts, which replace amount
+    };
+
+    /**
+     * Single-producer, single-consumer ring owned by one logging thread.
+     * Stays registered after its thread exits until the drain thread empties it.
+     */
+    struct Ring {
+        static constexpr size_t kCapacity = 4096; // power of two
+
+        alignas(64) std::atomic<size_t> head{0}; // next record to drain; written by the drain thread
+        alignas(64) std::atomic<size_t> tail{0}; // next free slot; written by the owning thread
+        std::atomic<bool> abandoned{false};
+        Record records[kCapacity];
+    };
+
+    // Marks the calling thread's ring abandoned when the thread exits.
+    struct RingOwner {
+        std::shared_ptr<Ring> ring;
+        ~RingOwner() {
+            if (ring) {
+                ring->abandoned.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    PaymentLog() : drainer([this] { drainLoop(); }) {}
+
+    ~PaymentLog() {
+        flush();
+        stopping.store(true, std::memory_order_release);
+        wake();
+        drainer.join();
+    }
+
+    Ring& threadRing() {
+        thread_local RingOwner owner;
+        if (!owner.ring) {
+            owner.ring = std::make_shared<Ring>();
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.push_back(owner.ring);
+        }
+        return *owner.ring;
+    }
+
+    void append(const Record& record) {
+        Ring& ring = threadRing();
+        size_t tail = ring.tail.load(std::memory_order_relaxed);
+        // A full ring waits for the drain thread rather than losing payment records.
+        while (tail - ring.head.load(std::memory_order_acquire) == Ring::kCapacity) {
+            std::this_thread::yield();
+        }
+        ring.records[tail & (Ring::kCapacity - 1)] = record;
+        ring.tail.store(tail + 1, std::memory_order_release);
+        // Pairs with the fence in park(): either the drain thread sees this record
+        // before it sleeps, or this sees the ring was empty and the thread parked.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring.head.load(std::memory_order_relaxed) == tail) {
+            wake();
+        }
+    }
+
+    // Wakes the drain thread if it is parked.
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_relaxed) && parked.exchange(false, std::memory_order_relaxed)) {
+            parked.notify_one();
+        }
+    }
+
+    // Sleeps until wake(), unless a record, flush or stop arrived since the last empty pass.
+    void park(uint64_t ticket) {
+        parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!drainOnce() && flushRequested.load(std::memory_order_relaxed) == ticket &&
+            !stopping.load(std::memory_order_relaxed)) {
+            parked.wait(true, std::memory_order_relaxed);
+        }
+        parked.store(false, std::memory_order_relaxed);
+    }
+
+    void drainLoop() {
+        for (;;) {
+            bool stop = stopping.load(std::memory_order_acquire);
+            uint64_t ticket = flushRequested.load(std::memory_order_acquire);
+            bool drained = drainOnce();
+            if (ticket > flushedThrough.load(std::memory_order_relaxed)) {
+                {
+                    std::lock_guard<std::mutex> lock(flushMutex);
+                    flushedThrough = ticket;
+                }
+                flushed.notify_all();
+            }
+            if (stop) {
+                return;
+            }
+            if (!drained && flushRequested.load(std::memory_order_acquire) == ticket) {
+                park(ticket);
+            }
+        }
+    }
+
+    // Formats and writes whatever the rings hold; returns false if they were all empty.
+    bool drainOnce() {
+        std::vector<std::shared_ptr<Ring>> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            snapshot = rings;
+        }
+        bool any = false;
+        for (const std::shared_ptr<Ring>& ring : snapshot) {
+            bool abandoned = ring->abandoned.load(std::memory_order_acquire);
+            size_t head = ring->head.load(std::memory_order_relaxed);
+            size_t tail = ring->tail.load(std::memory_order_acquire);
+            for (; head != tail; ++head) {
+                format(ring->records[head & (Ring::kCapacity - 1)]);
+                ring->head.store(head + 1, std::memory_order_release);
+                any = true;
+            }
+            if (abandoned) {
+                std::lock_guard<std::mutex> lock(ringsMutex);
+                rings.erase(std::find(rings.begin(), rings.end(), ring));
+            }
+        }
+        writeBuffer();
+        return any;
+    }
+
+    void format(const Record& record) {
+        if (bufferSize + kMaxLine > sizeof(buffer)) {
+            writeBuffer();
+        }
+        appendText(record.text);
+        if (record.middle) {
+            bufferSize = size_t(std::to_chars(buffer + bufferSize, buffer + sizeof(buffer), record.count).ptr - buffer);
+            appendText(record.middle);
+        }
+        if (record.currency) {
+            appendMoney(record.minorUnits, record.currency);
+        } else {
+            // Same text as streaming a double with default ostream settings (%g, 6 digits).
+            bufferSize = size_t(std::to_chars(buffer + bufferSize, buffer + sizeof(buffer), record.amount,
+                                         std::chars_format::general, 6).ptr - buffer);
+        }
+        buffer[bufferSize++] = '\n';
+    }
+
+    // Writes minor units as "<major>.<two digits> <currency>", exactly.
+    void appendMoney(int64_t minorUnits, const char* currency) {
+        uint64_t magnitude = minorUnits < 0 ? 0 - uint64_t(minorUnits) : uint64_t(minorUnits);
+        if (minorUnits < 0) {
+            buffer[bufferSize++] = '-';
+        }
+        uint64_t perMajor = uint64_t(Money::kMinorPerMajor);
+        bufferSize = size_t(std::to_chars(buffer + bufferSize, buffer + sizeof(buffer), magnitude / perMajor).ptr - buffer);
+        buffer[bufferSize++] = '.';
+        buffer[bufferSize++] = char('0' + magnitude % perMajor / 10);
+        buffer[bufferSize++] = char('0' + magnitude % 10);
+        buffer[bufferSize++] = ' ';
+        appendText(currency);
+    }
+
+    void appendText(const char* text) {
+        size_t length = std::min(std::strlen(text), kMaxText);
+        std::memcpy(buffer + bufferSize, text, length);
+        bufferSize += length;
+    }
+
+    void writeBuffer() {
+        int fd = outputFd.load(std::memory_order_relaxed);
+        for (size_t written = 0; written < bufferSize;) {
+            ssize_t result = ::write(fd, buffer + written, bufferSize - written);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                break; // nowhere to report a failing log descriptor; drop the batch
+            }
+            written += size_t(result);
+        }
+        bufferSize = 0;
+    }
+
+    static constexpr size_t kMaxText = 256;                // longest message text kept per part
+    static constexpr size_t kMaxLine = 3 * kMaxText + 64;  // room for all texts, two numbers and '\n'
+
+    std::mutex ringsMutex; // guards rings; taken once per thread and once per drain pass
+    std::vector<std::shared_ptr<Ring>> rings;
+
+    // Drain thread only.
+    char buffer[64 * 1024];
+    size_t bufferSize = 0;
+
+    std::atomic<int> outputFd{STDOUT_FILENO};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> parked{false}; // the drain thread is asleep, or about to re-check and sleep
+    std::mutex flushMutex;
+    std::condition_variable flushed;
+    std::atomic<uint64_t> flushRequested{0};
+    std::atomic<uint64_t> flushedThrough{0};
+
+    std::thread drainer; // declared last, so it starts after everything it uses
+};
+
+/**
+ * Interface representing a general payment method.
+ * All concrete payment methods will implement this interface.
+ */
+class PaymentMethod {
+public:
+    /**
+     * Processes the payment of a specified amount.
+     * 
+     * @param amount The amount to be paid.
+     */
+    virtual void pay(double amount) = 0;
+
+    /**
+     * Processes several payments with one call, so a backend can submit them upstream
+     * together. The default pays each amount on its own.
+     *
+     * @param amounts The amounts to be paid.
+     */
+    virtual void payBatch(std::span<const double> amounts) {
+        for (double amount : amounts) {
+            pay(amount);
+        }
+    }
+
+    /**
+     * Processes the payment of an exact amount.
+     * The default converts to major units for methods that only implement pay(double).
+     *
+     * @param amount The amount to be paid.
+     */
+    virtual void pay(Money amount) {
+        pay(amount.toMajor());
+    }
+
+    /**
+     * Processes several exact payments in one currency with one call.
+     * The amounts have already passed validateMinorUnits(). The default pays each
+     * amount on its own.
+     *
+     * @param minorUnits The amounts to be paid, in minor units.
+     * @param currency The currency of every amount.
+     */
+    virtual void payBatch(std::span<const int64_t> minorUnits, Currency currency) {
+        for (int64_t amount : minorUnits) {
+            pay(Money{amount, currency});
+        }
+    }
+
+    /**
+     * Processes a payment on a thread pool, holding one slot of the window until it
+     * completes. Blocks while the window is full, so call it from outside the pool.
+     * The default runs pay() on a pool thread and holds that thread for the whole
+     * payment, so at most the pool's thread count of payments make progress at once;
+     * window slots beyond that only queue. A backend with a non-blocking upstream API
+     * can override it to complete the future from its own callback instead.
+     *
+     * @param amount The amount to be paid.
+     * @param pool The threads that run the payment.
+     * @param window The in-flight limit for this payment method.
+     * @return A future that becomes ready once the payment is processed.
+     */
+    virtual std::future<void> payAsync(double amount, WorkStealingPool& pool, InFlightWindow& window) {
+        window.acquire();
+        try {
+            return pool.submit([this, amount, &window] {
+                struct Release {
+                    InFlightWindow& window;
+                    ~Release() { window.release(); }
+                } release{window};
+                pay(amount);
+            });
+        } catch (...) {
+            window.release();
+            throw;
+        }
+    }
+
+    // Virtual destructor to ensure proper cleanup of derived classes.
+    virtual ~PaymentMethod() {}
+};
+
+/**
+ * Concrete implementation of the PaymentMethod interface for CreditCard payments.
+ */
+class CreditCard final : public PaymentMethod {
+public:
+    using PaymentMethod::pay;
+    using PaymentMethod::payBatch;
+
+    /**
+     * Processes the payment through a credit card.
+     * 
+     * @param amount The amount to be paid using a credit card.
+     */
+    void pay(double amount) override {
+        // Simulate calling the API for credit card payment processing
+        PaymentLog::instance().log("Payment Processing from Credit Card for amount = ", amount);
+    }
+
+    /**
+     * Processes several payments through one simulated credit card API call.
+     * 
+     * @param amounts The amounts to be paid.
+     */
+    void payBatch(std::span<const double> amounts) override {
+        double total = 0;
+        for (double amount : amounts) {
+            total += amount;
+        }
+        PaymentLog::instance().log("Batch Payment Processing from Credit Card for ", amounts.size(), " payments, total = ", total);
+    }
+
+    /**
+     * Processes an exact payment through a credit card.
+     * 
+     * @param amount The amount to be paid.
+     */
+    void pay(Money amount) override {
+        PaymentLog::instance().log("Payment Processing from Credit Card for amount = ", amount);
+    }
+
+    /**
+     * Processes several exact payments through one simulated credit card API call.
+     * 
+     * @param minorUnits The amounts to be paid, in minor units.
+     * @param currency The currency of every amount.
+     */
+    void payBatch(std::span<const int64_t> minorUnits, Currency currency) override {
+        Money total{sumMinorUnits(minorUnits), currency};
+        PaymentLog::instance().log("Batch Payment Processing from Credit Card for ", minorUnits.size(), " payments, total = ", total);
+    }
+};
+
+/**
+ * Concrete implementation of the PaymentMethod interface for DebitCard payments.
+ */
+class DebitCard final : public PaymentMethod {
+public:
+    using PaymentMethod::pay;
+    using PaymentMethod::payBatch;
+
+    /**
+     * Processes the payment through a debit card.
+     * 
+     * @param amount The amount to be paid using a debit card.
+     */
+    void pay(double amount) override {
+        // Simulate calling the API for debit card payment processing
+        PaymentLog::instance().log("Payment Processing for Debit Card for amount = ", amount);
+    }
+
+    /**
+     * Processes several payments through one simulated debit card API call.
+     * 
+     * @param amounts The amounts to be paid.
+     */
+    void payBatch(std::span<const double> amounts) override {
+        double total = 0;
+        for (double amount : amounts) {
+            total += amount;
+        }
+        PaymentLog::instance().log("Batch Payment Processing for Debit Card for ", amounts.size(), " payments, total = ", total);
+    }
+
+    /**
+     * Processes an exact payment through a debit card.
+     * 
+     * @param amount The amount to be paid.
+     */
+    void pay(Money amount) override {
+        PaymentLog::instance().log("Payment Processing for Debit Card for amount = ", amount);
+    }
+
+    /**
+     * Processes several exact payments through one simulated debit card API call.
+     * 
+     * @param minorUnits The amounts to be paid, in minor units.
+     * @param currency The currency of every amount.
+     */
+    void payBatch(std::span<const int64_t> minorUnits, Currency currency) override {
+        Money total{sumMinorUnits(minorUnits), currency};
+        PaymentLog::instance().log("Batch Payment Processing for Debit Card for ", minorUnits.size(), " payments, total = ", total);
+    }
+};
+
+/**
+ * Concrete implementation of the PaymentMethod interface for UPI (Unified Payments Interface) payments.
+ */
+class UPI final : public PaymentMethod {
+public:
+    using PaymentMethod::pay;
+    using PaymentMethod::payBatch;
+
+    /**
+     * Processes the payment through UPI.
+     * 
+     * @param amount The amount to be paid using UPI.
+     */
+    void pay(double amount) override {
+        // Simulate calling the API for UPI payment processing
+        PaymentLog::instance().log("Payment Processing for UPI for amount = ", amount);
+    }
+
+    /**
+     * Processes several payments through one simulated UPI API call.
+     * 
+     * @param amounts The amounts to be paid.
+     */
+    void payBatch(std::span<const double> amounts) override {
+        double total = 0;
+        for (double amount : amounts) {
+            total += amount;
+        }
+        PaymentLog::instance().log("Batch Payment Processing for UPI for ", amounts.size(), " payments, total = ", total);
+    }
+
+    /**
+     * Processes an exact payment through a UPI.
+     * 
+     * @param amount The amount to be paid.
+     */
+    void pay(Money amount) override {
+        PaymentLog::instance().log("Payment Processing for UPI for amount = ", amount);
+    }
+
+    /**
+     * Processes several exact payments through one simulated UPI API call.
+     * 
+     * @param minorUnits The amounts to be paid, in minor units.
+     * @param currency The currency of every amount.
+     */
+    void payBatch(std::span<const int64_t> minorUnits, Currency currency) override {
+        Money total{sumMinorUnits(minorUnits), currency};
+        PaymentLog::instance().log("Batch Payment Processing for UPI for ", minorUnits.size(), " payments, total = ", total);
+    }
+};
+
+/**
+ * Concrete implementation of the PaymentMethod interface for NetBanking payments.
+ */
+class NetBanking final : public PaymentMethod {
+public:
+    using PaymentMethod::pay;
+    using PaymentMethod::payBatch;
+
+    /**
+     * Processes the payment through NetBanking.
+     * 
+     * @param amount The amount to be paid using NetBanking.
+     */
+    void pay(double amount) override {
+        // Simulate calling the API for NetBanking payment processing
+        PaymentLog::instance().log("Payment Processing for NetBanking for amount = ", amount);
+    }
+
+    /**
+     * Processes several payments through one simulated NetBanking API call.
+     * 
+     * @param amounts The amounts to be paid.
+     */
+    void payBatch(std::span<const double> amounts) override {
+        double total = 0;
+        for (double amount : amounts) {
+            total += amount;
+        }
+        PaymentLog::instance().log("Batch Payment Processing for NetBanking for ", amounts.size(), " payments, total = ", total);
+    }
+
+    /**
+     * Processes an exact payment through a NetBanking.
+     * 
+     * @param amount The amount to be paid.
+     */
+    void pay(Money amount) override {
+        PaymentLog::instance().log("Payment Processing for NetBanking for amount = ", amount);
+    }
+
+    /**
+     * Processes several exact payments through one simulated NetBanking API call.
+     * 
+     * @param minorUnits The amounts to be paid, in minor units.
+     * @param currency The currency of every amount.
+     */
+    void payBatch(std::span<const int64_t> minorUnits, Currency currency) override {
+        Money total{sumMinorUnits(minorUnits), currency};
+        PaymentLog::instance().log("Batch Payment Processing for NetBanking for ", minorUnits.size(), " payments, total = ", total);
+    }
+};
+
+/**
+ * The payment methods the factory can create.
+ */
+enum class PaymentMode {
+    CreditCard,
+    DebitCard,
+    UPI,
+    NetBanking
+};
+
+// Number of PaymentMode values; modes are numbered from 0.
+inline constexpr size_t kPaymentModeCount = 4;
+
+/**
+ * Building blocks of the compile-time perfect hash over payment mode names.
+ * A seed is searched for at compile time so that every name lands in its own slot.
+ */
+struct PaymentModeHashing {
+    struct Name {
+        std::string_view name;
+        PaymentMode mode;
+    };
+
+    struct Slot {
+        std::string_view name;
+        PaymentMode mode = PaymentMode::CreditCard;
+        bool used = false;
+    };
+
+    static constexpr Name kNames[] = {
+        {"creditcard", PaymentMode::CreditCard},
+        {"debitcard", PaymentMode::DebitCard},
+        {"upi", PaymentMode::UPI},
+        {"netbanking", PaymentMode::NetBanking},
+    };
+
+    // Twice the number of names, so a collision-free seed is quick to find; matches hash()'s 3 output bits.
+    static constexpr size_t kSlotCount = 8;
+
+    struct Slots {
+        Slot slot[kSlotCount];
+    };
+
+    /**
+     * Hashes only the length and the first and last characters, which already tell the
+     * mode names apart; the seed picks the multiplier. The full name is compared once
+     * after the slot is found, so unknown names are still rejected.
+     */
+    static constexpr uint32_t hash(std::string_view name, uint32_t seed) {
+        if (name.empty()) {
+            return 0;
+        }
+        uint32_t key = uint32_t(name.size()) << 16 | uint32_t(static_cast<unsigned char>(name.front())) << 8 |
+                       static_cast<unsigned char>(name.back());
+        return (key * (2654435761u + 2 * seed)) >> 29; // top bits select one of kSlotCount slots
+    }
+
+    static constexpr bool isPerfect(uint32_t seed) {
+        bool taken[kSlotCount] = {};
+        for (const Name& entry : kNames) {
+            size_t slot = hash(entry.name, seed) & (kSlotCount - 1);
+            if (taken[slot]) {
+                return false;
+            }
+            taken[slot] = true;
+        }
+        return true;
+    }
+
+    static constexpr uint32_t findSeed() {
+        uint32_t seed = 0;
+        while (!isPerfect(seed)) {
+            ++seed;
+        }
+        return seed;
+    }
+
+    static constexpr Slots buildSlots(uint32_t seed) {
+        Slots table{};
+        for (const Name& entry : kNames) {
+            Slot& slot = table.slot[hash(entry.name, seed) & (kSlotCount - 1)];
+            slot.name = entry.name;
+            slot.mode = entry.mode;
+            slot.used = true;
+        }
+        return table;
+    }
+};
+
+/**
+ * Compile-time perfect hash from payment mode names to PaymentMode.
+ * Resolving a name costs one hash and at most one string comparison.
+ */
+class PaymentModeTable {
+public:
+    /**
+     * Resolves a mode name.
+     * @param name The payment mode (e.g., "creditcard").
+     * @return The matching mode, or nullopt if the name is unrecognized.
+     */
+    static constexpr std::optional<PaymentMode> find(std::string_view name) {
+        const PaymentModeHashing::Slot& slot =
+            slots.slot[PaymentModeHashing::hash(name, seed) & (PaymentModeHashing::kSlotCount - 1)];
+        if (slot.used && slot.name == name) {
+            return slot.mode;
+        }
+        return std::nullopt;
+    }
+
+private:
+    static constexpr uint32_t seed = PaymentModeHashing::findSeed();
+    static constexpr PaymentModeHashing::Slots slots = PaymentModeHashing::buildSlots(seed);
+};
+
+static_assert(PaymentModeTable::find("upi") == PaymentMode::UPI, "mode names must resolve at compile time");
+static_assert(!PaymentModeTable::find("cash"), "unknown mode names must not resolve");
+
+/**
+ * Closed set of the built-in payment methods, held by value.
+ * Calling pay() through std::visit resolves the concrete type without a virtual call,
+ * and because each method is final the compiler can inline its pay(). PaymentMethod
+ * stays the extension point for methods added outside this set.
+ */
+using PaymentVariant = std::variant<CreditCard, DebitCard, UPI, NetBanking>;
+
+/**
+ * Processes a payment with whichever method the variant holds.
+ *
+ * @param method The payment method.
+ * @param amount The amount to be paid.
+ */
+inline void pay(PaymentVariant& method, double amount) {
+    std::visit([amount](auto& concrete) { concrete.pay(amount); }, method);
+}
+
+/**
+ * Processes an exact payment with whichever method the variant holds.
+ *
+ * @param method The payment method.
+ * @param amount The amount to be paid.
+ */
+inline void pay(PaymentVariant& method, Money amount) {
+    std::visit([amount](auto& concrete) { concrete.pay(amount); }, method);
+}
+
+/**
+ * One shared instance of each payment method (Flyweight).
+ * The concrete methods hold no state, so a single instance of each can serve every
+ * caller on every thread. The instances are constant-initialized, so reaching them
+ * needs neither an allocation nor a thread-safe initialization check.
+ */
+struct SharedPaymentMethods {
+    static inline constinit CreditCard creditCard{};
+    static inline constinit DebitCard debitCard{};
+    static inline constinit UPI upi{};
+    static inline constinit NetBanking netBanking{};
+};
+
+/**
+ * Registry of payment methods added at runtime, e.g. by modules at startup.
+ * The name-to-creator map is immutable once published: a registration copies the
+ * current map, adds the new creator and publishes the copy through an atomic
+ * pointer. Lookups only load that pointer, so they are wait-free and never take a
+ * lock, even while another thread registers. Replaced maps are kept until the
+ * registry is destroyed, since a reader may still be using one; registering n
+ * methods therefore keeps n maps, which is fine for startup-time registration.
+ */
+class PaymentRegistry {
+public:
+    using Creator = std::function<std::unique_ptr<PaymentMethod>()>;
+
+    // The registry PaymentFactory consults for modes it has no built-in method for.
+    static PaymentRegistry& global() {
+        static PaymentRegistry registry;
+        return registry;
+    }
+
+    PaymentRegistry() : current(publish(std::make_unique<Map>())) {}
+
+    PaymentRegistry(const PaymentRegistry&) = delete;
+    PaymentRegistry& operator=(const PaymentRegistry&) = delete;
+
+    /**
+     * Registers a creator for a payment mode name. Safe to call while other threads look up.
+     *
+     * @param mode The payment mode name (e.g., "wallet").
+     * @param creator Creates a new instance of the method on each call.
+     * @throws invalid_argument if the name is empty, built in or already registered.
+     */
+    void registerMethod(std::string_view mode, Creator creator) {
+        if (mode.empty() || !creator) {
+            throw std::invalid_argument("Payment mode needs a name and a creator");
+        }
+        if (PaymentModeTable::find(mode)) {
+            throw std::invalid_argument("Payment mode is built in: " + std::string(mode));
+        }
+        std::lock_guard<std::mutex> lock(writeMutex);
+        const Map& latest = *current.load(std::memory_order_relaxed);
+        if (latest.find(mode) != latest.end()) {
+            throw std::invalid_argument("Payment mode already registered: " + std::string(mode));
+        }
+        auto next = std::make_unique<Map>(latest);
+        next->emplace(std::string(mode), std::move(creator));
+        current.store(publish(std::move(next)), std::memory_order_release);
+    }
+
+    /**
+     * Creates an instance of a registered payment method. Wait-free.
+     *
+     * @param mode The payment mode name.
+     * @return A new instance, or nullptr if the mode is not registered.
+     */
+    std::unique_ptr<PaymentMethod> create(std::string_view mode) const {
+        const Map& map = *current.load(std::memory_order_acquire);
+        auto found = map.find(mode);
+        return found != map.end() ? found->second() : nullptr;
+    }
+
+    // Whether a payment mode name is registered. Wait-free.
+    bool contains(std::string_view mode) const {
+        const Map& map = *current.load(std::memory_order_acquire);
+        return map.find(mode) != map.end();
+    }
+
+private:
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    using Map = std::unordered_map<std::string, Creator, NameHash, std::equal_to<>>;
+
+    // Keeps a map alive for the registry's lifetime and returns it for publishing.
+    const Map* publish(std::unique_ptr<Map> map) {
+        published.push_back(std::move(map));
+        return published.back().get();
+    }
+
+    std::mutex writeMutex;                     // serializes registrations; readers never take it
+    std::vector<std::unique_ptr<const Map>> published; // every map ever published, newest last
+    std::atomic<const Map*> current;
+};
+
+/**
+ * Factory class responsible for creating instances of different PaymentMethod implementations.
+ * This class follows the Factory design pattern.
+ */
+class PaymentFactory {
+public:
+    /**
+     * Creates and returns an instance of a PaymentMethod for the given mode.
+     * Dispatches through a jump table instead of comparing names.
+     *
+     * @param mode The payment mode.
+     * @return A concrete implementation of PaymentMethod corresponding to the mode.
+     */
+    static PaymentMethod* createPayment(PaymentMode mode) {
+        switch (mode) {
+            case PaymentMode::CreditCard: return new CreditCard();
+            case PaymentMode::DebitCard:  return new DebitCard();
+            case PaymentMode::UPI:        return new UPI();
+            case PaymentMode::NetBanking: return new NetBanking();
+        }
+        return nullptr;
+    }
+
+    /**
+     * Creates and returns an instance of a PaymentMethod based on the provided mode name.
+     * Built-in names are resolved with a compile-time perfect hash; any other name is
+     * looked up in PaymentRegistry::global().
+     * 
+     * @param mode The payment mode (e.g., "creditcard", "debitcard", "upi", "netbanking").
+     * @return A concrete implementation of PaymentMethod corresponding to the mode.
+     *         Returns nullptr if the mode is unrecognized.
+     */
+    static PaymentMethod* createPayment(std::string_view mode) {
+        std::optional<PaymentMode> resolved = PaymentModeTable::find(mode);
+        if (resolved) {
+            return createPayment(*resolved);
+        }
+        return PaymentRegistry::global().create(mode).release();  // nullptr if the mode is invalid or unrecognized.
+    }
+
+    /**
+     * Creates a payment method by value, for callers that stay within the built-in
+     * methods and want pay() dispatched statically. Nothing is allocated.
+     *
+     * @param mode The payment mode.
+     * @return The payment method corresponding to the mode.
+     */
+    static PaymentVariant createPaymentVariant(PaymentMode mode) {
+        switch (mode) {
+            case PaymentMode::CreditCard: return CreditCard();
+            case PaymentMode::DebitCard:  return DebitCard();
+            case PaymentMode::UPI:        return UPI();
+            case PaymentMode::NetBanking: return NetBanking();
+        }
+        return CreditCard(); // unreachable for valid enum values
+    }
+
+    /**
+     * Returns the shared instance of a PaymentMethod for the given mode.
+     * Nothing is allocated and the caller must not delete the result.
+     *
+     * @param mode The payment mode.
+     * @return The shared PaymentMethod for the mode, valid for the whole program.
+     */
+    static PaymentMethod& sharedPayment(PaymentMode mode) {
+        switch (mode) {
+            case PaymentMode::CreditCard: return SharedPaymentMethods::creditCard;
+            case PaymentMode::DebitCard:  return SharedPaymentMethods::debitCard;
+            case PaymentMode::UPI:        return SharedPaymentMethods::upi;
+            case PaymentMode::NetBanking: return SharedPaymentMethods::netBanking;
+        }
+        return SharedPaymentMethods::creditCard; // unreachable for valid enum values
+    }
+
+    /**
+     * Returns the shared instance of a PaymentMethod based on the provided mode name.
+     *
+     * @param mode The payment mode (e.g., "creditcard", "debitcard", "upi", "netbanking").
+     * @return The shared PaymentMethod for the mode, or nullptr if the mode is unrecognized.
+     *         The caller must not delete the result.
+     */
+    static PaymentMethod* sharedPayment(std::string_view mode) {
+        std::optional<PaymentMode> resolved = PaymentModeTable::find(mode);
+        return resolved ? &sharedPayment(*resolved) : nullptr;
+    }
+};
+
+/**
+ * One payment of a batch.
+ */
+struct PaymentRecord {
+    PaymentMode mode;
+    double amount;
+};
+
+/**
+ * One exact payment of a batch; the batch supplies the currency.
+ */
+struct MoneyRecord {
+    PaymentMode mode;
+    int64_t minorUnits;
+};
+
+/**
+ * Settles many payments with one payBatch() call per payment method.
+ * Records are grouped by method with a counting sort, which keeps each method's
+ * amounts in their original order. The grouping buffer is reused across calls,
+ * so a long-lived batch stops allocating once it has seen its largest input.
+ */
+class PaymentBatch {
+public:
+    /**
+     * Groups the records by method and pays each group through its shared method.
+     *
+     * @param records The payments to settle.
+     * @throws invalid_argument if a record holds a value outside PaymentMode.
+     */
+    void process(std::span<const PaymentRecord> records) {
+        auto start = group(records, grouped, [](const PaymentRecord& record) { return record.amount; });
+        for (size_t mode = 0; mode < kPaymentModeCount; ++mode) {
+            if (start[mode + 1] > start[mode]) {
+                std::span<const double> amounts(grouped.data() + start[mode], start[mode + 1] - start[mode]);
+                PaymentFactory::sharedPayment(static_cast<PaymentMode>(mode)).payBatch(amounts);
+            }
+        }
+    }
+
+    /**
+     * Validates exact amounts, then groups the records by method and pays each group
+     * through its shared method. Nothing is paid if any amount is invalid.
+     *
+     * @param records The payments to settle.
+     * @param currency The currency of every record.
+     * @throws invalid_argument if a record holds a value outside PaymentMode, or an
+     *         amount that is not positive or exceeds kMaxPaymentMinorUnits.
+     */
+    void process(std::span<const MoneyRecord> records, Currency currency) {
+        auto start = group(records, groupedMinorUnits, [](const MoneyRecord& record) { return record.minorUnits; });
+        validateMinorUnits(groupedMinorUnits); // contiguous, so the check vectorizes
+        for (size_t mode = 0; mode < kPaymentModeCount; ++mode) {
+            if (start[mode + 1] > start[mode]) {
+                std::span<const int64_t> amounts(groupedMinorUnits.data() + start[mode], start[mode + 1] - start[mode]);
+                PaymentFactory::sharedPayment(static_cast<PaymentMode>(mode)).payBatch(amounts, currency);
+            }
+        }
+    }
+
+private:
+    /**
+     * Counting-sorts the records' amounts by mode into out.
+     * @return Where each mode's amounts start in out; entry kPaymentModeCount is the end.
+     */
+    template <typename Record, typename Amount, typename AmountOf>
+    static std::array<size_t, kPaymentModeCount + 1> group(std::span<const Record> records, std::vector<Amount>& out, AmountOf amountOf) {
+        std::array<size_t, kPaymentModeCount + 1> start{};
+        for (const Record& record : records) {
+            size_t mode = static_cast<size_t>(record.mode);
+            if (mode >= kPaymentModeCount) {
+                throw std::invalid_argument("Unknown payment mode in batch");
+            }
+            ++start[mode + 1];
+        }
+        for (size_t mode = 0; mode < kPaymentModeCount; ++mode) {
+            start[mode + 1] += start[mode];
+        }
+        out.resize(records.size());
+        std::array<size_t, kPaymentModeCount> next{};
+        std::copy(start.begin(), start.end() - 1, next.begin());
+        for (const Record& record : records) {
+            out[next[static_cast<size_t>(record.mode)]++] = amountOf(record);
+        }
+        return start;
+    }
+
+    std::vector<double> grouped;
+    std::vector<int64_t> groupedMinorUnits;
+};
+
+/**
+ * Runs payments asynchronously on a shared work-stealing pool, with a separate
+ * in-flight window for each payment method so a slow backend cannot take every
+ * thread and queue slot from the others.
+ */
+class AsyncPaymentEngine {
+public:
+    /**
+     * With the default payAsync(), no more than threadCount payments run at once, so a
+     * windowPerMethod above threadCount only lets more of them queue.
+     *
+     * @param threadCount Threads in the pool.
+     * @param windowPerMethod Payments of one method allowed in flight at once.
+     */
+    AsyncPaymentEngine(size_t threadCount, ptrdiff_t windowPerMethod) : pool(threadCount) {
+        for (auto& window : windows) {
+            window = std::make_unique<InFlightWindow>(windowPerMethod);
+        }
+    }
+
+    /**
+     * Submits a payment through the method's shared instance.
+     * Blocks while that method's window is full.
+     *
+     * @param mode The payment mode.
+     * @param amount The amount to be paid.
+     * @return A future that becomes ready once the payment is processed.
+     */
+    std::future<void> pay(PaymentMode mode, double amount) {
+        size_t index = static_cast<size_t>(mode);
+        if (index >= kPaymentModeCount) {
+            throw std::invalid_argument("Unknown payment mode");
+        }
+        return PaymentFactory::sharedPayment(mode).payAsync(amount, pool, *windows[index]);
+    }
+
+private:
+    std::array<std::unique_ptr<InFlightWindow>, kPaymentModeCount> windows; // outlive the pool's tasks
+    WorkStealingPool pool; // destroyed first, finishing queued payments
+};
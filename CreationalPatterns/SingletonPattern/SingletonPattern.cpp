@@ -1,115 +1,16 @@
+#include "SingletonPattern.hpp"
+
+#include <chrono>
+#include <cstdio>
 #include <iostream>
-#include <unordered_map>
 #include <string>
-#include <mutex>
-
-/**
- * A Singleton class that manages a single in-memory cache for key-value pairs.
- * Ensures only one cache instance exists, providing global access to store and retrieve data.
- * Useful in scenarios like caching database results or API responses to improve performance.
- * Uses lazy initialization with thread-safe std::call_once.
- */
-class CacheManager {
-public:
-    // Delete copy constructor and assignment operator to prevent copies
-    CacheManager(const CacheManager&) = delete;
-    CacheManager& operator=(const CacheManager&) = delete;
-
-    /**
-     * Gets the single instance of CacheManager, creating it if necessary.
-     * Uses std::call_once for thread-safe lazy initialization.
-     * @return Reference to the single CacheManager instance.
-     */
-    static CacheManager& getInstance() {
-        std::call_once(initInstanceFlag, &CacheManager::initSingleton);
-        return *instance;
-    }
-
-    /**
-     * Stores a key-value pair in the cache.
-     * Overwrites the value if the key already exists.
-     * @param key The cache key (e.g., "user:123").
-     * @param value The value to store (e.g., user data, API response).
-     */
-    void put(const std::string& key, const std::string& value) {
-        if (key.empty()) {
-            throw std::invalid_argument("Cache key cannot be empty");
-        }
-        std::lock_guard<std::mutex> lock(cacheMutex);
-        cache[key] = value;
-    }
-
-    /**
-     * Retrieves a value from the cache by key.
-     * @param key The cache key to look up.
-     * @return The value associated with the key, or empty string if not found.
-     */
-    std::string get(const std::string& key) {
-        if (key.empty()) {
-            throw std::invalid_argument("Cache key cannot be empty");
-        }
-        std::lock_guard<std::mutex> lock(cacheMutex);
-        auto it = cache.find(key);
-        if (it != cache.end()) {
-            return it->second;
-        }
-        return ""; // or throw or use std::optional in C++17+
-    }
-
-    /**
-     * Clears all entries in the cache.
-     */
-    void clear() {
-        std::lock_guard<std::mutex> lock(cacheMutex);
-        cache.clear();
-    }
-
-    /**
-     * Gets the current size of the cache.
-     * @return The number of key-value pairs in the cache.
-     */
-    size_t size() {
-        std::lock_guard<std::mutex> lock(cacheMutex);
-        return cache.size();
-    }
-
-    /**
-     * Prints the cache contents.
-     */
-    void print() {
-        std::lock_guard<std::mutex> lock(cacheMutex);
-        std::cout << "Cache Contents:\n";
-        if (cache.empty()) {
-            std::cout << "  (empty)\n";
-        } else {
-            for (const auto& [key, value] : cache) {
-                std::cout << "  Key: " << key << ", Value: " << value << "\n";
-            }
-        }
-    }
-
-private:
-    CacheManager() = default; // Private constructor
-
-    static void initSingleton() {
-        instance = new CacheManager();
-    }
-
-    static CacheManager* instance;
-    static std::once_flag initInstanceFlag;
-
-    std::unordered_map<std::string, std::string> cache;
-    std::mutex cacheMutex; // protects cache from concurrent access
-};
-
-// Static member initialization
-CacheManager* CacheManager::instance = nullptr;
-std::once_flag CacheManager::initInstanceFlag;
-
+#include <string_view>
+#include <thread>
 
 // Demonstration
 int main() {
-    CacheManager& cache1 = CacheManager::getInstance();
+    // The first call decides the cache layout; later calls share the same instance.
+    CacheManager& cache1 = CacheManager::getInstance({/*shardCount=*/4, CacheManager::ConcurrencyMode::SharedRead});
 
     // Store some data
     cache1.put("user:123", "Alice Smith");
@@ -128,6 +29,24 @@ int main() {
     // Retrieve a value
     std::cout << "\nRetrieving user:123: " << cache1.get("user:123") << "\n";
 
+    // Read without copying: a shared handle, or a visitor that runs under the shard lock
+    std::string_view themeKey = "config:theme";
+    ValueHandle theme = cache1.getShared(themeKey);
+    std::cout << "Shared handle for config:theme: " << theme.view() << "\n";
+    cache1.visit(themeKey, [](std::string_view value) {
+        std::cout << "Visited config:theme (" << value.size() << " bytes): " << value << "\n";
+    });
+
+    // Look up several keys in one call; results land in a caller-supplied buffer
+    std::string_view batchKeys[] = {"user:123", "user:456", "user:999"};
+    ValueHandle batchResults[3];
+    size_t found = cache1.multiGet(batchKeys, batchResults);
+    std::cout << "multiGet found " << found << " of 3:";
+    for (const ValueHandle& result : batchResults) {
+        std::cout << " [" << (result ? result.view() : "miss") << "]";
+    }
+    std::cout << "\n";
+
     // Verify same instance
     std::cout << "Is same instance? " << (&cache1 == &cache2 ? "true" : "false") << "\n";
 
@@ -137,5 +56,55 @@ int main() {
     std::cout << "Cache 1 Contents (same instance):\n";
     cache1.print(); // Empty
 
+    // A bounded cache keeps at most 48 bytes of keys and values, evicting the least recently used.
+    ShardedCache bounded({/*shardCount=*/1, ShardedCache::ConcurrencyMode::Exclusive,
+                          /*maxBytes=*/48, ShardedCache::EvictionPolicy::LRU});
+    bounded.put("user:123", "Alice Smith");
+    bounded.put("user:456", "Bob Jones");
+    bounded.get("user:123"); // user:123 is now the most recently used
+    bounded.put("user:789", "Carol White"); // evicts user:456
+    std::cout << "\nBounded cache after exceeding its budget:\n";
+    bounded.print();
+    CacheStats stats = bounded.getStats();
+    std::cout << "Hits: " << stats.hits << ", Misses: " << stats.misses
+              << ", Evictions: " << stats.evictions << ", Bytes: " << stats.bytes << "\n";
+
+    // Entries stored with a time-to-live disappear once it elapses.
+    cache1.put("api:/users/123", "{\"name\": \"Alice\"}", std::chrono::milliseconds(50));
+    std::cout << "\nFresh API response: " << cache1.get("api:/users/123") << "\n";
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    std::cout << "After its TTL: \"" << cache1.get("api:/users/123") << "\"\n";
+    cache1.purgeExpired();
+    std::cout << "Expired entries reclaimed: " << cache1.getStats().expirations << "\n";
+
+    // Save the cache to disk and warm a fresh cache from it; entries load lazily on first read.
+    cache1.put("user:123", "Alice Smith");
+    cache1.put("session:42", "token-abc", std::chrono::minutes(5));
+    const std::string snapshotPath = "/tmp/cache_manager.snapshot";
+    std::cout << "\nSaved " << cache1.saveSnapshot(snapshotPath) << " entries to " << snapshotPath << "\n";
+    ShardedCache restarted({/*shardCount=*/4});
+    std::cout << "Warm start mapped " << restarted.warmStart(snapshotPath) << " entries, "
+              << restarted.size() << " in memory\n";
+    std::cout << "user:123 after warm start: " << restarted.get("user:123") << "\n";
+    std::cout << "Entries in memory after one read: " << restarted.size()
+              << ", snapshot hits: " << restarted.getStats().snapshotHits << "\n";
+    std::remove(snapshotPath.c_str());
+
+    // Fixed-width keys, such as request fingerprints, need no key string.
+    CacheKey128 responseKey{0x8a1f03c2d4e5b697, 0x1c2d3e4f5a6b7c8d};
+    cache1.put(responseKey, "{\"users\": []}");
+    std::cout << "\nResponse under a 128-bit key: " << cache1.get(responseKey) << "\n";
+
+    // Counters and latency percentiles are read without locking the cache.
+    for (int i = 0; i < 1000; ++i) {
+        cache1.get("user:123");
+    }
+    MetricsSnapshot metrics = cache1.getMetrics();
+    std::cout << "\nMetrics: " << metrics.hits << " hits, " << metrics.misses << " misses, "
+              << metrics.puts << " puts, " << metrics.lockWaits << " lock waits, "
+              << metrics.entries << " entries\n";
+    std::cout << "Sampled get latency p50/p99: " << metrics.getLatency.percentile(50) << "/"
+              << metrics.getLatency.percentile(99) << " ns over " << metrics.getLatency.count() << " samples\n";
+
     return 0;
 }
@@ -0,0 +1,2235 @@
+#pragma once
+
+#include <iostream>
+#include <array>
+#include <unordered_map>
+#include <list>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <span>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <concepts>
+#include <optional>
+#include <tuple>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Latency distribution with HDR-style log-linear buckets: each power of two is split
+ * into eight equal sub-buckets, so any recorded value is reported within 12.5%.
+ * Covers 0 ns up to about 18 minutes; longer samples land in the last bucket.
+ */
+struct LatencyHistogram {
+    static constexpr size_t kSubBuckets = 8;
+    static constexpr size_t kBuckets = kSubBuckets * 38;
+
+    std::array<unsigned long long, kBuckets> counts{};
+
+    static size_t bucketFor(unsigned long long nanos) {
+        if (nanos < kSubBuckets) {
+            return size_t(nanos);
+        }
+        unsigned exponent = 63u - unsigned(__builtin_clzll(nanos)); // at least 3
+        size_t bucket = (exponent - 2) * kSubBuckets + ((nanos >> (exponent - 3)) & (kSubBuckets - 1));
+        return std::min(bucket, kBuckets - 1);
+    }
+
+    // Smallest value that falls into a bucket.
+    static unsigned long long lowerBound(size_t bucket) {
+        if (bucket < kSubBuckets) {
+            return bucket;
+        }
+        unsigned exponent = unsigned(bucket / kSubBuckets) + 2;
+        return (kSubBuckets + bucket % kSubBuckets) << (exponent - 3);
+    }
+
+    unsigned long long count() const {
+        unsigned long long total = 0;
+        for (unsigned long long c : counts) {
+            total += c;
+        }
+        return total;
+    }
+
+    /**
+     * Estimates a percentile from the bucket midpoints.
+     * @param percentile Between 0 and 100 (e.g., 99.9).
+     * @return Nanoseconds, or 0 if nothing was recorded.
+     */
+    unsigned long long percentile(double percentile) const {
+        unsigned long long total = count();
+        if (total == 0) {
+            return 0;
+        }
+        auto rank = static_cast<unsigned long long>(percentile / 100.0 * double(total - 1)) + 1;
+        unsigned long long seen = 0;
+        for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+            seen += counts[bucket];
+            if (seen >= rank) {
+                return bucket + 1 < kBuckets ? (lowerBound(bucket) + lowerBound(bucket + 1)) / 2 : lowerBound(bucket);
+            }
+        }
+        return lowerBound(kBuckets - 1);
+    }
+};
+
+/**
+ * Point-in-time totals read from a cache's metrics without taking any cache lock.
+ * Counters are summed from independent per-thread stripes, so totals taken while
+ * the cache is busy may be a few operations apart from each other.
+ */
+struct MetricsSnapshot {
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    unsigned long long puts = 0;
+    unsigned long long evictions = 0;
+    unsigned long long expirations = 0;
+    unsigned long long snapshotHits = 0;
+    unsigned long long lockWaits = 0;     // lock acquisitions that found the shard lock taken
+    unsigned long long lockWaitNanos = 0; // total time spent waiting in those acquisitions
+    size_t entries = 0;                   // as of each shard's last write
+    size_t bytes = 0;
+    LatencyHistogram getLatency;          // sampled; see CacheSettings::Options::latencySampleEvery
+    LatencyHistogram putLatency;
+};
+
+/**
+ * Hot-path counters and latency histograms for one cache.
+ * Each thread updates its own cache-line aligned stripe, so counting never bounces
+ * a shared line between cores; readers add the stripes up. Latency is timed on one
+ * operation in sampleEvery per thread, keeping clock reads off most calls.
+ */
+class CacheMetrics {
+public:
+    enum Counter {
+        Hits,
+        Misses,
+        Puts,
+        Evictions,
+        Expirations,
+        SnapshotHits,
+        LockWaits,
+        LockWaitNanos,
+        kCounterCount
+    };
+
+    explicit CacheMetrics(unsigned sampleEvery) : stripes(new Stripe[kStripes]), sampleEvery(sampleEvery) {}
+
+    void add(Counter counter, unsigned long long amount = 1) {
+        stripe().counters[counter].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    // Decides whether the calling thread times its current operation.
+    bool shouldSample() {
+        if (sampleEvery == 0) {
+            return false;
+        }
+        thread_local unsigned countdown = 0;
+        if (countdown == 0) {
+            countdown = sampleEvery;
+            return true;
+        }
+        --countdown;
+        return false;
+    }
+
+    void recordGet(unsigned long long nanos) { record(&Stripe::getLatency, nanos); }
+    void recordPut(unsigned long long nanos) { record(&Stripe::putLatency, nanos); }
+
+    // Adds every stripe into the counter and histogram fields of a snapshot.
+    void collect(MetricsSnapshot& out) const {
+        unsigned long long totals[kCounterCount] = {};
+        for (size_t s = 0; s < kStripes; ++s) {
+            const Stripe& stripe = stripes[s];
+            for (size_t c = 0; c < kCounterCount; ++c) {
+                totals[c] += stripe.counters[c].load(std::memory_order_relaxed);
+            }
+            for (size_t b = 0; b < LatencyHistogram::kBuckets; ++b) {
+                out.getLatency.counts[b] += stripe.getLatency[b].load(std::memory_order_relaxed);
+                out.putLatency.counts[b] += stripe.putLatency[b].load(std::memory_order_relaxed);
+            }
+        }
+        out.hits = totals[Hits];
+        out.misses = totals[Misses];
+        out.puts = totals[Puts];
+        out.evictions = totals[Evictions];
+        out.expirations = totals[Expirations];
+        out.snapshotHits = totals[SnapshotHits];
+        out.lockWaits = totals[LockWaits];
+        out.lockWaitNanos = totals[LockWaitNanos];
+    }
+
+    static unsigned long long nowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    // Threads beyond this many share stripes, which stays correct but may contend.
+    static constexpr size_t kStripes = 16;
+
+    struct alignas(64) Stripe {
+        std::atomic<unsigned long long> counters[kCounterCount] = {};
+        std::atomic<unsigned long long> getLatency[LatencyHistogram::kBuckets] = {};
+        std::atomic<unsigned long long> putLatency[LatencyHistogram::kBuckets] = {};
+    };
+
+    // Threads get stripes round-robin the first time they touch any cache.
+    static size_t threadStripe() {
+        static std::atomic<size_t> nextStripe{0};
+        thread_local size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % kStripes;
+        return stripe;
+    }
+
+    Stripe& stripe() { return stripes[threadStripe()]; }
+
+    void record(std::atomic<unsigned long long> (Stripe::*histogram)[LatencyHistogram::kBuckets], unsigned long long nanos) {
+        (stripe().*histogram)[LatencyHistogram::bucketFor(nanos)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<Stripe[]> stripes;
+    unsigned sampleEvery;
+};
+
+/**
+ * Lock guarding one cache shard.
+ * In exclusive mode every caller takes the same std::mutex; in shared-read mode
+ * readers share a std::shared_mutex and only writers are serialized.
+ * Satisfies SharedLockable, so it works with std::unique_lock and std::shared_lock.
+ * Each acquisition tries the lock first and reads the clock only when that fails,
+ * so uncontended locking costs nothing extra while waits are still reported.
+ */
+class ShardMutex {
+public:
+    // Selects the locking strategy; must be called before the shard is shared between threads.
+    void setSharedReads(bool enabled) { sharedReads = enabled; }
+
+    // Sets where lock waits are reported; must be called before the shard is shared between threads.
+    void setMetrics(CacheMetrics* target) { metrics = target; }
+
+    void lock() {
+        if (sharedReads ? rwMutex.try_lock() : mutex.try_lock()) {
+            return;
+        }
+        unsigned long long start = CacheMetrics::nowNanos();
+        if (sharedReads) rwMutex.lock(); else mutex.lock();
+        recordWait(start);
+    }
+
+    void unlock() {
+        if (sharedReads) rwMutex.unlock(); else mutex.unlock();
+    }
+
+    void lock_shared() {
+        if (sharedReads ? rwMutex.try_lock_shared() : mutex.try_lock()) {
+            return;
+        }
+        unsigned long long start = CacheMetrics::nowNanos();
+        if (sharedReads) rwMutex.lock_shared(); else mutex.lock();
+        recordWait(start);
+    }
+
+    void unlock_shared() {
+        if (sharedReads) rwMutex.unlock_shared(); else mutex.unlock();
+    }
+
+private:
+    void recordWait(unsigned long long start) {
+        if (metrics) {
+            metrics->add(CacheMetrics::LockWaits);
+            metrics->add(CacheMetrics::LockWaitNanos, CacheMetrics::nowNanos() - start);
+        }
+    }
+
+    std::mutex mutex;
+    std::shared_mutex rwMutex;
+    bool sharedReads = false;
+    CacheMetrics* metrics = nullptr;
+};
+
+/**
+ * Hierarchical timing wheel that schedules cache keys for expiry.
+ * Level 0 has one slot per tick; each slot of a higher level covers a full turn of
+ * the level below it, and its timers are cascaded down as that turn comes up.
+ * Scheduling is O(1), and advancing visits one slot per elapsed tick at most,
+ * jumping straight over stretches where the lower levels are empty.
+ */
+class TimerWheel {
+public:
+    // Copies of scheduled keys are allocated from resource.
+    explicit TimerWheel(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : resource(resource) {}
+
+    /**
+     * Schedules a key to expire at the given tick.
+     * Deadlines that are already due fire on the next tick.
+     */
+    void schedule(std::string_view key, unsigned long long deadline) {
+        place(Timer{std::pmr::string(key, resource), std::max(deadline, currentTick + 1)});
+    }
+
+    /**
+     * Moves the wheel toward nowTick, visiting at most maxSlots slots, and calls
+     * onExpire(key) for every timer that came due. Timers may be stale (the key was
+     * rewritten or removed since), so the callback must re-check the entry.
+     */
+    template <typename OnExpire>
+    void advance(unsigned long long nowTick, size_t maxSlots, OnExpire&& onExpire) {
+        while (currentTick < nowTick && maxSlots-- > 0) {
+            if (pending == 0) {
+                currentTick = nowTick;
+                return;
+            }
+            // Jump to the next tick that can have work: while the low levels are empty,
+            // nothing happens until the next level boundary cascades timers down.
+            unsigned long long next = currentTick + 1;
+            for (size_t level = 0; level + 1 < kLevels && perLevel[level] == 0; ++level) {
+                unsigned long long span = 1ull << ((level + 1) * kSlotBits);
+                next = (currentTick / span + 1) * span;
+            }
+            currentTick = std::min(next, nowTick);
+
+            for (size_t level = kLevels - 1; level > 0; --level) {
+                if ((currentTick & ((1ull << (level * kSlotBits)) - 1)) == 0) {
+                    cascade(level, (currentTick >> (level * kSlotBits)) & kSlotMask);
+                }
+            }
+
+            std::vector<Timer> due = std::move(slots[0][currentTick & kSlotMask]);
+            slots[0][currentTick & kSlotMask].clear();
+            perLevel[0] -= due.size();
+            pending -= due.size();
+            for (Timer& timer : due) {
+                if (timer.deadline <= currentTick) {
+                    onExpire(timer.key);
+                } else {
+                    place(std::move(timer)); // clamped to the wheel's range; not due yet
+                }
+            }
+        }
+    }
+
+    // Gets the number of scheduled timers, including stale ones.
+    size_t size() const { return pending; }
+
+    void clear() {
+        for (auto& level : slots) {
+            for (auto& slot : level) {
+                slot.clear();
+            }
+        }
+        std::fill(std::begin(perLevel), std::end(perLevel), 0);
+        pending = 0;
+    }
+
+private:
+    static constexpr size_t kLevels = 4;
+    static constexpr size_t kSlotBits = 6;
+    static constexpr size_t kSlots = 1 << kSlotBits;
+    static constexpr unsigned long long kSlotMask = kSlots - 1;
+
+    struct Timer {
+        std::pmr::string key;
+        unsigned long long deadline;
+    };
+
+    // Files a timer under the level whose slot width matches its distance from now.
+    void place(Timer&& timer) {
+        const unsigned long long maxDelta = (1ull << (kLevels * kSlotBits)) - 1;
+        // Deadlines beyond the wheel's range are clamped and re-filed when they come around.
+        unsigned long long delta = std::min(std::max(timer.deadline, currentTick) - currentTick, maxDelta);
+        unsigned long long target = currentTick + delta;
+        size_t level = 0;
+        while (level + 1 < kLevels && delta >= (1ull << ((level + 1) * kSlotBits))) {
+            ++level;
+        }
+        slots[level][(target >> (level * kSlotBits)) & kSlotMask].push_back(std::move(timer));
+        ++perLevel[level];
+        ++pending;
+    }
+
+    // Re-files every timer of one higher-level slot into the levels below.
+    void cascade(size_t level, size_t slot) {
+        std::vector<Timer> timers = std::move(slots[level][slot]);
+        slots[level][slot].clear();
+        perLevel[level] -= timers.size();
+        pending -= timers.size();
+        for (Timer& timer : timers) {
+            place(std::move(timer));
+        }
+    }
+
+    std::pmr::memory_resource* resource;
+    std::vector<Timer> slots[kLevels][kSlots];
+    size_t perLevel[kLevels] = {};
+    size_t pending = 0;
+    unsigned long long currentTick = 0;
+};
+
+/**
+ * Memory resource that carves small allocations out of 32 KiB slabs, one size class per slab.
+ * Freed blocks are reused within their class, and trim() hands slabs that have become
+ * completely empty back to the upstream resource, so the footprint follows the live data.
+ * Blocks are never relocated, because map nodes and value handles point straight into them.
+ * Allocations above the largest class, and every allocation while pooling is off, go to the
+ * upstream resource directly. Thread-safe, since value handles may release blocks without
+ * holding the owning shard's lock.
+ */
+class SlabArena : public std::pmr::memory_resource {
+public:
+    explicit SlabArena(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream(upstream) {}
+
+    SlabArena(const SlabArena&) = delete;
+    SlabArena& operator=(const SlabArena&) = delete;
+
+    ~SlabArena() override {
+        for (SizeClass& sizeClass : classes) {
+            for (Slab** list : {&sizeClass.partial, &sizeClass.full, &sizeClass.empty}) {
+                while (*list) {
+                    Slab* slab = *list;
+                    *list = slab->next;
+                    upstream->deallocate(slab, kSlabSize, kSlabSize);
+                }
+            }
+        }
+    }
+
+    // Turns slab pooling on or off; must be called before the first allocation.
+    void setPooling(bool enabled) { pooling = enabled; }
+
+    /**
+     * Returns empty slabs to the upstream resource, keeping one spare per size class
+     * so a class that drains and refills does not thrash.
+     */
+    void trim() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (SizeClass& sizeClass : classes) {
+            while (sizeClass.empty && sizeClass.empty->next) {
+                Slab* slab = sizeClass.empty;
+                unlink(sizeClass.empty, slab);
+                upstream->deallocate(slab, kSlabSize, kSlabSize);
+                reserved.fetch_sub(kSlabSize, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Gets how many times memory was requested from the upstream resource.
+    unsigned long long upstreamAllocations() const { return upstreamCalls.load(std::memory_order_relaxed); }
+
+    // Gets the bytes currently held from the upstream resource.
+    size_t reservedBytes() const { return reserved.load(std::memory_order_relaxed); }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        size_t index = classFor(bytes, alignment);
+        if (index == kNoClass) {
+            upstreamCalls.fetch_add(1, std::memory_order_relaxed);
+            reserved.fetch_add(bytes, std::memory_order_relaxed);
+            return upstream->allocate(bytes, alignment);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        SizeClass& sizeClass = classes[index];
+        if (!sizeClass.partial) {
+            Slab* slab = sizeClass.empty;
+            if (slab) {
+                unlink(sizeClass.empty, slab);
+            } else {
+                slab = newSlab(index);
+            }
+            push(sizeClass.partial, slab);
+        }
+        Slab* slab = sizeClass.partial;
+        void* block;
+        if (slab->freeList) {
+            block = slab->freeList;
+            slab->freeList = slab->freeList->next;
+        } else {
+            block = reinterpret_cast<char*>(slab) + kHeaderSize + slab->carved * kClassSizes[index];
+            ++slab->carved;
+        }
+        if (++slab->live == slab->capacity) {
+            unlink(sizeClass.partial, slab);
+            push(sizeClass.full, slab);
+        }
+        return block;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        size_t index = classFor(bytes, alignment);
+        if (index == kNoClass) {
+            reserved.fetch_sub(bytes, std::memory_order_relaxed);
+            upstream->deallocate(p, bytes, alignment);
+            return;
+        }
+        // Slabs are aligned to their size, so the owning slab is found by masking the address.
+        Slab* slab = reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(p) & ~(uintptr_t(kSlabSize) - 1));
+        std::lock_guard<std::mutex> lock(mutex);
+        SizeClass& sizeClass = classes[index];
+        if (slab->live-- == slab->capacity) {
+            unlink(sizeClass.full, slab);
+            push(sizeClass.partial, slab);
+        }
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        block->next = slab->freeList;
+        slab->freeList = block;
+        if (slab->live == 0) {
+            unlink(sizeClass.partial, slab);
+            push(sizeClass.empty, slab);
+        }
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    static constexpr size_t kSlabSize = 32 * 1024;
+    static constexpr size_t kBlockAlign = 16;
+    static constexpr size_t kClassSizes[] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512,
+                                             768, 1024, 1536, 2048, 3072, 4096};
+    static constexpr size_t kClassCount = sizeof(kClassSizes) / sizeof(kClassSizes[0]);
+    static constexpr size_t kNoClass = kClassCount;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // Header at the start of every slab; blocks follow it.
+    struct Slab {
+        Slab* prev;
+        Slab* next;
+        FreeBlock* freeList; // blocks released since the slab was carved
+        size_t carved;       // blocks handed out from the uncarved tail so far
+        size_t live;
+        size_t capacity;
+    };
+
+    static constexpr size_t kHeaderSize = (sizeof(Slab) + 63) / 64 * 64;
+
+    // Slabs of one block size, grouped by how full they are.
+    struct SizeClass {
+        Slab* partial = nullptr;
+        Slab* full = nullptr;
+        Slab* empty = nullptr;
+    };
+
+    size_t classFor(size_t bytes, size_t alignment) const {
+        if (!pooling || alignment > kBlockAlign) {
+            return kNoClass;
+        }
+        for (size_t i = 0; i < kClassCount; ++i) {
+            if (bytes <= kClassSizes[i]) {
+                return i;
+            }
+        }
+        return kNoClass;
+    }
+
+    Slab* newSlab(size_t index) {
+        Slab* slab = static_cast<Slab*>(upstream->allocate(kSlabSize, kSlabSize));
+        upstreamCalls.fetch_add(1, std::memory_order_relaxed);
+        reserved.fetch_add(kSlabSize, std::memory_order_relaxed);
+        *slab = Slab{nullptr, nullptr, nullptr, 0, 0, (kSlabSize - kHeaderSize) / kClassSizes[index]};
+        return slab;
+    }
+
+    static void push(Slab*& head, Slab* slab) {
+        slab->prev = nullptr;
+        slab->next = head;
+        if (head) {
+            head->prev = slab;
+        }
+        head = slab;
+    }
+
+    static void unlink(Slab*& head, Slab* slab) {
+        if (slab->prev) {
+            slab->prev->next = slab->next;
+        } else {
+            head = slab->next;
+        }
+        if (slab->next) {
+            slab->next->prev = slab->prev;
+        }
+    }
+
+    std::pmr::memory_resource* upstream;
+    bool pooling = false;
+    std::mutex mutex; // protects the slab lists
+    SizeClass classes[kClassCount];
+    std::atomic<unsigned long long> upstreamCalls{0};
+    std::atomic<size_t> reserved{0};
+};
+
+/**
+ * Hashes and compares cache keys as string views, so lookups by std::string_view,
+ * const char* or std::string need no temporary key string.
+ */
+struct CacheKeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+};
+
+struct CacheKeyEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view lhs, std::string_view rhs) const { return lhs == rhs; }
+};
+
+/**
+ * Fixed-width 128-bit cache key, such as an HttpRequest fingerprint.
+ * It is stored as a tag byte followed by its two words in big-endian order, so
+ * the stored form is the same on every platform and snapshot, and fits inline in
+ * a table slot or node. String keys may not start with the tag byte, which keeps
+ * the two kinds of key apart while they share eviction, expiry and snapshots.
+ */
+struct CacheKey128 {
+    static constexpr char kTag = '\0';
+    static constexpr size_t kEncodedSize = 1 + 2 * sizeof(uint64_t);
+
+    // The stored form of a key.
+    struct Encoded {
+        char bytes[kEncodedSize];
+
+        std::string_view view() const { return {bytes, kEncodedSize}; }
+    };
+
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    CacheKey128() = default;
+    constexpr CacheKey128(uint64_t high, uint64_t low) : high(high), low(low) {}
+
+    // Converts any 128-bit hash made of high and low words, such as a RequestFingerprint.
+    template <typename Hash>
+        requires std::same_as<decltype(Hash::high), uint64_t> && std::same_as<decltype(Hash::low), uint64_t>
+    constexpr CacheKey128(const Hash& hash) : high(hash.high), low(hash.low) {}
+
+    Encoded encode() const {
+        Encoded encoded;
+        encoded.bytes[0] = kTag;
+        for (size_t i = 0; i < 8; ++i) {
+            encoded.bytes[1 + i] = char(high >> (56 - 8 * i));
+            encoded.bytes[9 + i] = char(low >> (56 - 8 * i));
+        }
+        return encoded;
+    }
+
+    // Reads a stored key back, or returns std::nullopt for a string key.
+    static std::optional<CacheKey128> decode(std::string_view stored) {
+        if (stored.size() != kEncodedSize || stored.front() != kTag) {
+            return std::nullopt;
+        }
+        CacheKey128 key;
+        for (size_t i = 0; i < 8; ++i) {
+            key.high = key.high << 8 | uint8_t(stored[1 + i]);
+            key.low = key.low << 8 | uint8_t(stored[9 + i]);
+        }
+        return key;
+    }
+
+    friend bool operator==(const CacheKey128&, const CacheKey128&) = default;
+};
+
+/**
+ * Cache key bytes stored inline when short, otherwise in memory from a table's resource.
+ * Trivially copyable, so rehashing can move slots without touching the key bytes' owner.
+ */
+struct InlineKey {
+    static constexpr size_t kInlineCapacity = 24;
+
+    size_t length;
+    union {
+        char inlined[kInlineCapacity];
+        char* external;
+    };
+
+    std::string_view view() const {
+        return {length <= kInlineCapacity ? inlined : external, length};
+    }
+
+    void assign(std::string_view key, std::pmr::memory_resource* resource) {
+        length = key.size();
+        char* target = inlined;
+        if (length > kInlineCapacity) {
+            target = external = static_cast<char*>(resource->allocate(length, 1));
+        }
+        std::memcpy(target, key.data(), length);
+    }
+
+    void release(std::pmr::memory_resource* resource) {
+        if (length > kInlineCapacity) {
+            resource->deallocate(external, length, 1);
+        }
+    }
+};
+
+/**
+ * Cache storage engine backed by std::pmr::unordered_map.
+ * Every entry is its own node, so pointers to entries survive any insert.
+ * The precomputed hash is ignored, because the standard map always hashes again.
+ * Keys of up to 24 bytes, CacheKey128 included, are stored inside the node.
+ */
+template <typename Mapped>
+class NodeTable {
+public:
+    explicit NodeTable(std::pmr::memory_resource* resource) : map(resource) {}
+
+    size_t size() const { return map.size(); }
+
+    Mapped* find(std::string_view key, size_t /*hash*/) {
+        auto it = map.find(key);
+        return it == map.end() ? nullptr : &it->second;
+    }
+
+    // Inserts a default-constructed value for a key that is not present yet.
+    Mapped* insert(std::string_view key, size_t /*hash*/) {
+        return &map.emplace(std::piecewise_construct, std::forward_as_tuple(key, map.get_allocator().resource()),
+                            std::forward_as_tuple()).first->second;
+    }
+
+    void erase(std::string_view key, size_t /*hash*/) {
+        auto it = map.find(key);
+        if (it != map.end()) {
+            map.erase(it);
+        }
+    }
+
+    void clear() { map.clear(); }
+
+    void prefetch(size_t /*hash*/) const {} // node addresses are unknown until the bucket is walked
+
+    // Calls fn(std::string_view key, const Mapped& value) for every entry.
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const auto& [key, value] : map) {
+            fn(std::string_view(key), value);
+        }
+    }
+
+private:
+    // Owns its key bytes; map nodes never move, so they are released with the node.
+    class NodeKey {
+    public:
+        NodeKey(std::string_view key, std::pmr::memory_resource* resource) : resource(resource) {
+            bytes.assign(key, resource);
+        }
+
+        NodeKey(const NodeKey&) = delete;
+        NodeKey& operator=(const NodeKey&) = delete;
+
+        ~NodeKey() { bytes.release(resource); }
+
+        operator std::string_view() const { return bytes.view(); }
+
+    private:
+        InlineKey bytes;
+        std::pmr::memory_resource* resource;
+    };
+
+    std::pmr::unordered_map<NodeKey, Mapped, CacheKeyHash, CacheKeyEqual> map;
+};
+
+/**
+ * Cache storage engine using open addressing in the style of a Swiss table.
+ * One control byte per slot holds 7 bits of the hash (or an empty/deleted marker),
+ * and lookups compare a whole group of 16 control bytes at once (with SSE2 where
+ * available) before touching any key. Keys of up to 24 bytes are stored inline in
+ * the slot, so short keys such as "user:123" are found without chasing a pointer.
+ * Inserts may move entries, so pointers returned by find() are only valid until
+ * the next insert.
+ */
+template <typename Mapped>
+class FlatTable {
+public:
+    explicit FlatTable(std::pmr::memory_resource* resource) : resource(resource) {}
+
+    FlatTable(const FlatTable&) = delete;
+    FlatTable& operator=(const FlatTable&) = delete;
+
+    ~FlatTable() {
+        clear();
+        release();
+    }
+
+    size_t size() const { return count; }
+
+    Mapped* find(std::string_view key, size_t hash) {
+        size_t index = findIndex(key, hash);
+        return index == kNotFound ? nullptr : &slots[index].value;
+    }
+
+    // Inserts a default-constructed value for a key that is not present yet.
+    Mapped* insert(std::string_view key, size_t hash) {
+        if ((count + tombstones + 1) * 8 > capacity * 7) {
+            rehash(count + 1 > capacity / 2 ? std::max<size_t>(kGroupSize, capacity * 2) : capacity);
+        }
+        size_t index = findFreeSlot(hash);
+        if (control[index] == kDeleted) {
+            --tombstones;
+        }
+        control[index] = tagOf(hash);
+        Slot& slot = slots[index];
+        slot.key.assign(key, resource);
+        new (&slot.value) Mapped();
+        ++count;
+        return &slot.value;
+    }
+
+    void erase(std::string_view key, size_t hash) {
+        size_t index = findIndex(key, hash);
+        if (index == kNotFound) {
+            return;
+        }
+        destroy(slots[index]);
+        control[index] = kDeleted;
+        --count;
+        ++tombstones;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (isFull(control[i])) {
+                destroy(slots[i]);
+                control[i] = kEmpty;
+            } else if (control[i] == kDeleted) {
+                control[i] = kEmpty;
+            }
+        }
+        count = 0;
+        tombstones = 0;
+    }
+
+    // Pulls the control group and first slots a lookup of this hash will read into cache.
+    void prefetch(size_t hash) const {
+        if (capacity) {
+            size_t group = groupOf(hash);
+            __builtin_prefetch(control + group * kGroupSize);
+            __builtin_prefetch(slots + group * kGroupSize);
+        }
+    }
+
+    // Calls fn(std::string_view key, const Mapped& value) for every entry.
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (isFull(control[i])) {
+                fn(slots[i].key.view(), slots[i].value);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kGroupSize = 16;
+    static constexpr unsigned char kEmpty = 0x80;
+    static constexpr unsigned char kDeleted = 0xFE;
+    static constexpr size_t kNotFound = static_cast<size_t>(-1);
+
+    struct Slot {
+        InlineKey key;
+        Mapped value;
+    };
+
+    static bool isFull(unsigned char ctrl) { return (ctrl & 0x80) == 0; }
+    static unsigned char tagOf(size_t hash) { return hash & 0x7F; }
+    size_t groupOf(size_t hash) const { return (hash >> 7) & (groupCount - 1); }
+
+    // Returns a bitmask of the control bytes in a 16-byte group that equal `byte`.
+    static unsigned matchByte(const unsigned char* ctrl, unsigned char byte) {
+#if defined(__SSE2__)
+        __m128i group = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+        return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(byte)))));
+#else
+        unsigned mask = 0;
+        for (size_t i = 0; i < kGroupSize; ++i) {
+            mask |= unsigned(ctrl[i] == byte) << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Returns a bitmask of the empty or deleted control bytes in a group.
+    static unsigned matchFree(const unsigned char* ctrl) {
+#if defined(__SSE2__)
+        __m128i group = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+        return static_cast<unsigned>(_mm_movemask_epi8(group)); // free markers have the high bit set
+#else
+        unsigned mask = 0;
+        for (size_t i = 0; i < kGroupSize; ++i) {
+            mask |= unsigned(!isFull(ctrl[i])) << i;
+        }
+        return mask;
+#endif
+    }
+
+    size_t findIndex(std::string_view key, size_t hash) const {
+        if (capacity == 0) {
+            return kNotFound;
+        }
+        const unsigned char tag = tagOf(hash);
+        size_t group = groupOf(hash);
+        for (size_t step = 1;; ++step) {
+            const unsigned char* ctrl = control + group * kGroupSize;
+            for (unsigned matches = matchByte(ctrl, tag); matches; matches &= matches - 1) {
+                size_t index = group * kGroupSize + __builtin_ctz(matches);
+                if (slots[index].key.view() == key) {
+                    return index;
+                }
+            }
+            if (matchByte(ctrl, kEmpty)) {
+                return kNotFound; // an empty slot ends the probe sequence
+            }
+            group = (group + step) & (groupCount - 1); // triangular probing visits every group
+        }
+    }
+
+    size_t findFreeSlot(size_t hash) const {
+        size_t group = groupOf(hash);
+        for (size_t step = 1;; ++step) {
+            if (unsigned free = matchFree(control + group * kGroupSize)) {
+                return group * kGroupSize + __builtin_ctz(free);
+            }
+            group = (group + step) & (groupCount - 1);
+        }
+    }
+
+    void destroy(Slot& slot) {
+        slot.key.release(resource);
+        slot.value.~Mapped();
+    }
+
+    // Moves every entry into freshly allocated arrays of the given capacity, dropping tombstones.
+    void rehash(size_t newCapacity) {
+        unsigned char* oldControl = control;
+        Slot* oldSlots = slots;
+        size_t oldCapacity = capacity;
+
+        capacity = newCapacity;
+        groupCount = newCapacity / kGroupSize;
+        control = static_cast<unsigned char*>(resource->allocate(capacity, kGroupSize));
+        slots = static_cast<Slot*>(resource->allocate(capacity * sizeof(Slot), alignof(Slot)));
+        std::memset(control, kEmpty, capacity);
+        tombstones = 0;
+
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (isFull(oldControl[i])) {
+                Slot& from = oldSlots[i];
+                size_t hash = CacheKeyHash{}(from.key.view());
+                size_t index = findFreeSlot(hash);
+                control[index] = tagOf(hash);
+                slots[index].key = from.key;
+                new (&slots[index].value) Mapped(std::move(from.value));
+                from.value.~Mapped();
+            }
+        }
+        if (oldCapacity) {
+            resource->deallocate(oldControl, oldCapacity, kGroupSize);
+            resource->deallocate(oldSlots, oldCapacity * sizeof(Slot), alignof(Slot));
+        }
+    }
+
+    void release() {
+        if (capacity) {
+            resource->deallocate(control, capacity, kGroupSize);
+            resource->deallocate(slots, capacity * sizeof(Slot), alignof(Slot));
+        }
+    }
+
+    std::pmr::memory_resource* resource;
+    unsigned char* control = nullptr;
+    Slot* slots = nullptr;
+    size_t capacity = 0;   // slots, always a multiple of kGroupSize and a power of two
+    size_t groupCount = 0;
+    size_t count = 0;
+    size_t tombstones = 0;
+};
+
+/**
+ * Binary snapshot of cache contents, written by SnapshotWriter and served by MappedSnapshot.
+ *
+ * Layout (native byte order, every section 8-byte aligned):
+ *   header   magic, version, byte-order mark, entry count, index position and slot count
+ *   records  per entry: u32 key length, u32 value length, i64 expiry (Unix ms, 0 = never),
+ *            key bytes, value bytes
+ *   index    open-addressing table of u64 record offsets + 1 (0 = empty slot),
+ *            probed linearly from FNV-1a(key)
+ */
+struct SnapshotFormat {
+    static constexpr char kMagic[8] = {'C', 'M', 'S', 'N', 'A', 'P', '0', '1'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kByteOrderMark = 0x01020304;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;
+        uint64_t entryCount;
+        uint64_t indexOffset;
+        uint64_t indexSlots; // power of two
+    };
+
+    struct RecordHeader {
+        uint32_t keyLength;
+        uint32_t valueLength;
+        int64_t expiresAt;
+    };
+
+    // Stable across builds and platforms, unlike std::hash, because the file outlives the process.
+    static uint64_t hashKey(std::string_view key) {
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : key) {
+            hash = (hash ^ c) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static uint64_t align8(uint64_t value) { return (value + 7) & ~uint64_t(7); }
+
+    static long long unixMillisNow() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+};
+
+/**
+ * Streams records into a snapshot file. The file is written under a temporary name
+ * and renamed into place by finish(), so readers never map a half-written snapshot.
+ */
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path) : path(path), tempPath(path + ".tmp") {
+        file = std::fopen(tempPath.c_str(), "wb");
+        if (!file) {
+            throw std::runtime_error("Cannot create snapshot file: " + tempPath);
+        }
+        std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        SnapshotFormat::Header placeholder{};
+        write(&placeholder, sizeof(placeholder));
+    }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    ~SnapshotWriter() {
+        if (file) {
+            std::fclose(file);
+            std::remove(tempPath.c_str());
+        }
+    }
+
+    // Appends one entry; expiresAt is in Unix milliseconds, 0 for entries that never expire.
+    void add(std::string_view key, std::string_view value, long long expiresAt) {
+        if (key.size() > std::numeric_limits<uint32_t>::max() || value.size() > std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("Snapshot records are limited to 4 GiB keys and values");
+        }
+        records.push_back({SnapshotFormat::hashKey(key), offset});
+        SnapshotFormat::RecordHeader header{uint32_t(key.size()), uint32_t(value.size()), expiresAt};
+        write(&header, sizeof(header));
+        write(key.data(), key.size());
+        write(value.data(), value.size());
+        pad();
+    }
+
+    /**
+     * Writes the index and header and publishes the file under its final name.
+     * @return The number of entries written.
+     */
+    size_t finish() {
+        uint64_t slots = 16;
+        while (slots < records.size() * 2) {
+            slots *= 2;
+        }
+        std::vector<uint64_t> index(slots, 0);
+        for (const Record& record : records) {
+            size_t slot = record.hash & (slots - 1);
+            while (index[slot] != 0) {
+                slot = (slot + 1) & (slots - 1);
+            }
+            index[slot] = record.offset + 1;
+        }
+        SnapshotFormat::Header header{};
+        std::memcpy(header.magic, SnapshotFormat::kMagic, sizeof(header.magic));
+        header.version = SnapshotFormat::kVersion;
+        header.byteOrderMark = SnapshotFormat::kByteOrderMark;
+        header.entryCount = records.size();
+        header.indexOffset = offset;
+        header.indexSlots = slots;
+        write(index.data(), index.size() * sizeof(uint64_t));
+        if (std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, file) != 1) {
+            throw std::runtime_error("Cannot write snapshot header: " + tempPath);
+        }
+        if (std::fclose(file) != 0) {
+            file = nullptr;
+            throw std::runtime_error("Cannot flush snapshot file: " + tempPath);
+        }
+        file = nullptr;
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Cannot publish snapshot file: " + path);
+        }
+        return records.size();
+    }
+
+private:
+    struct Record {
+        uint64_t hash;
+        uint64_t offset;
+    };
+
+    void write(const void* data, size_t size) {
+        if (size && std::fwrite(data, 1, size, file) != size) {
+            throw std::runtime_error("Cannot write snapshot file: " + tempPath);
+        }
+        offset += size;
+    }
+
+    void pad() {
+        static const char zeros[8] = {};
+        write(zeros, SnapshotFormat::align8(offset) - offset);
+    }
+
+    std::string path;
+    std::string tempPath;
+    std::FILE* file = nullptr;
+    uint64_t offset = 0;
+    std::vector<Record> records;
+};
+
+/**
+ * Read-only snapshot file mapped into memory.
+ * Opening validates only the header, so even a multi-gigabyte snapshot is ready to
+ * serve after one mmap call; pages are faulted in as lookups touch them. Lookups
+ * return views straight into the mapped pages.
+ * A per-slot "superseded" bit lets the cache retire records whose key has since
+ * been written, so an evicted newer value never falls back to the older snapshot one.
+ */
+class MappedSnapshot {
+public:
+    struct Record {
+        std::string_view key;
+        std::string_view value;
+        long long expiresAt; // Unix milliseconds, 0 = never expires
+        size_t slot;         // index slot, for supersede()
+    };
+
+    /**
+     * Maps a snapshot file.
+     * @throws std::runtime_error if the file cannot be mapped or is not a valid snapshot.
+     */
+    static std::shared_ptr<const MappedSnapshot> open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open snapshot file: " + path);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(SnapshotFormat::Header)) {
+            ::close(fd);
+            throw std::runtime_error("Snapshot file is truncated: " + path);
+        }
+        size_t length = size_t(info.st_size);
+        void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file alive
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map snapshot file: " + path);
+        }
+        std::shared_ptr<MappedSnapshot> snapshot(new MappedSnapshot(static_cast<const char*>(mapping), length));
+        const SnapshotFormat::Header& header = snapshot->header();
+        if (std::memcmp(header.magic, SnapshotFormat::kMagic, sizeof(header.magic)) != 0 ||
+            header.version != SnapshotFormat::kVersion ||
+            header.byteOrderMark != SnapshotFormat::kByteOrderMark ||
+            header.indexSlots == 0 || (header.indexSlots & (header.indexSlots - 1)) != 0 ||
+            header.indexOffset < sizeof(SnapshotFormat::Header) || header.indexOffset > length ||
+            header.indexOffset % 8 != 0 || // the index is read as u64 words in place
+            (length - header.indexOffset) / sizeof(uint64_t) < header.indexSlots) {
+            throw std::runtime_error("Not a valid cache snapshot: " + path);
+        }
+        ::madvise(mapping, length, MADV_RANDOM); // lookups jump around; skip read-ahead
+        snapshot->superseded.reset(new std::atomic<uint64_t>[(header.indexSlots + 63) / 64]());
+        return snapshot;
+    }
+
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    ~MappedSnapshot() {
+        ::munmap(const_cast<char*>(base), length);
+    }
+
+    size_t entryCount() const { return header().entryCount; }
+
+    /**
+     * Finds a key's record; superseded and malformed records are reported as missing.
+     */
+    bool find(std::string_view key, Record& out) const {
+        const SnapshotFormat::Header& head = header();
+        const uint64_t* index = reinterpret_cast<const uint64_t*>(base + head.indexOffset);
+        size_t mask = head.indexSlots - 1;
+        for (size_t slot = SnapshotFormat::hashKey(key) & mask, probes = 0; probes <= mask; slot = (slot + 1) & mask, ++probes) {
+            if (index[slot] == 0) {
+                return false;
+            }
+            if (!readRecord(index[slot] - 1, out) || out.key != key) {
+                continue;
+            }
+            out.slot = slot;
+            return !isSuperseded(slot);
+        }
+        return false;
+    }
+
+    // Calls fn(const Record&) for every record that has not been superseded.
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        const SnapshotFormat::Header& head = header();
+        const uint64_t* index = reinterpret_cast<const uint64_t*>(base + head.indexOffset);
+        Record record;
+        for (size_t slot = 0; slot < head.indexSlots; ++slot) {
+            if (index[slot] != 0 && !isSuperseded(slot) && readRecord(index[slot] - 1, record)) {
+                record.slot = slot;
+                fn(static_cast<const Record&>(record));
+            }
+        }
+    }
+
+    // Retires a key's record, if the snapshot has one.
+    void supersede(std::string_view key) const {
+        Record record;
+        if (find(key, record)) {
+            superseded[record.slot / 64].fetch_or(uint64_t(1) << (record.slot % 64), std::memory_order_relaxed);
+        }
+    }
+
+private:
+    MappedSnapshot(const char* base, size_t length) : base(base), length(length) {}
+
+    const SnapshotFormat::Header& header() const {
+        return *reinterpret_cast<const SnapshotFormat::Header*>(base);
+    }
+
+    bool isSuperseded(size_t slot) const {
+        return superseded[slot / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (slot % 64));
+    }
+
+    // Decodes the record at an offset, rejecting any that would run past the record area.
+    bool readRecord(uint64_t offset, Record& out) const {
+        uint64_t end = header().indexOffset;
+        // offset comes straight from the file: check it is below end before subtracting.
+        // Passing these checks puts bodyStart at or below end, so the next subtraction is safe too.
+        if (offset < sizeof(SnapshotFormat::Header) || offset % 8 != 0 || offset > end ||
+            end - offset < sizeof(SnapshotFormat::RecordHeader)) {
+            return false;
+        }
+        const auto* record = reinterpret_cast<const SnapshotFormat::RecordHeader*>(base + offset);
+        uint64_t bodyStart = offset + sizeof(SnapshotFormat::RecordHeader);
+        if (end - bodyStart < uint64_t(record->keyLength) + record->valueLength) {
+            return false;
+        }
+        out.key = std::string_view(base + bodyStart, record->keyLength);
+        out.value = std::string_view(base + bodyStart + record->keyLength, record->valueLength);
+        out.expiresAt = record->expiresAt;
+        return true;
+    }
+
+    const char* base;
+    size_t length;
+    std::unique_ptr<std::atomic<uint64_t>[]> superseded;
+};
+
+/**
+ * Hit, miss, eviction and expiry counters plus current occupancy, aggregated over all shards.
+ */
+struct CacheStats {
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    unsigned long long evictions = 0;
+    unsigned long long expirations = 0; // entries reclaimed by the timer wheel
+    unsigned long long snapshotHits = 0; // hits served from a warm-start snapshot, included in hits
+    size_t entries = 0;
+    size_t bytes = 0;                         // key and value bytes currently stored
+    size_t reservedBytes = 0;                 // memory the shards' storage holds from the system
+    unsigned long long systemAllocations = 0; // allocations requested from the system so far
+};
+
+template <template <typename> class Table>
+class BasicShardedCache;
+
+/**
+ * Shared, immutable view of a cached value.
+ * The value stays alive after it is overwritten or evicted, so a handle can be read
+ * without holding any cache lock and without copying the value.
+ * With arena storage the value lives in the cache's slabs, so handles must be
+ * released before the cache itself is destroyed. A value served from a warm-start
+ * snapshot points into the mapped file, which the handle keeps mapped.
+ */
+class ValueHandle {
+public:
+    ValueHandle() = default; // empty handle, returned on a miss
+
+    explicit operator bool() const { return owner != nullptr; }
+    std::string_view view() const { return bytes; }
+    const char* data() const { return bytes.data(); }
+    size_t size() const { return bytes.size(); }
+
+private:
+    template <template <typename> class Table>
+    friend class BasicShardedCache;
+    ValueHandle(std::shared_ptr<const void> owner, std::string_view bytes) : owner(std::move(owner)), bytes(bytes) {}
+
+    std::shared_ptr<const void> owner; // keeps the bytes alive: a stored value or a mapped snapshot
+    std::string_view bytes;
+};
+
+/**
+ * Runtime settings shared by every cache storage engine.
+ */
+struct CacheSettings {
+    /**
+     * How lookups synchronize with writers.
+     */
+    enum class ConcurrencyMode {
+        Exclusive,  // every operation takes the shard lock exclusively
+        SharedRead  // get() takes a shared lock, so readers never block each other
+    };
+
+    /**
+     * Which entry is dropped when a bounded shard runs over its budget.
+     */
+    enum class EvictionPolicy {
+        LRU,  // least recently used; a hit reorders a list, so get() locks exclusively
+        Clock // second-chance approximation of LRU; a hit only sets a flag, so get() can stay shared
+    };
+
+    /**
+     * Where keys, values and the cache's own nodes are allocated.
+     */
+    enum class StorageMode {
+        Heap, // one heap allocation per node, key and value
+        Arena // size-class slabs owned by each shard; empty slabs are released after eviction
+    };
+
+    /**
+     * Settings fixed when the cache is created.
+     */
+    struct Options {
+        size_t shardCount = 1; // number of independently locked shards
+        ConcurrencyMode concurrency = ConcurrencyMode::Exclusive;
+        size_t maxBytes = 0;   // total key + value bytes allowed, split evenly across shards; 0 = unbounded
+        EvictionPolicy eviction = EvictionPolicy::LRU;
+        std::chrono::milliseconds expiryTick{10}; // timer wheel resolution for time-to-live entries
+        StorageMode storage = StorageMode::Heap;
+        unsigned latencySampleEvery = 64; // time one get or put in this many per thread; 0 = no latency histograms
+    };
+};
+
+/**
+ * Thread-safe key-value store split into shards selected by key hash.
+ * Each shard is guarded by its own lock, so threads working on different keys
+ * rarely contend for the same lock.
+ * When a byte budget is set, each shard evicts entries on its own to stay within
+ * its share of the budget. Entries stored with a time-to-live are hidden from get()
+ * once they expire and reclaimed by a per-shard timer wheel as writes come in.
+ * The storage engine of each shard is chosen at compile time: NodeTable (the
+ * standard node-based map) or FlatTable (open addressing with inline short keys).
+ * String keys starting with a NUL byte are reserved for CacheKey128 keys, and every
+ * string-key method throws std::invalid_argument for them.
+ */
+template <template <typename> class Table = NodeTable>
+class BasicShardedCache : public CacheSettings {
+public:
+    explicit BasicShardedCache(const Options& options)
+        : metrics(options.latencySampleEvery), shards(makeShards(options, metrics)), shardCount(options.shardCount),
+          bounded(options.maxBytes > 0), policy(options.eviction),
+          tickMillis(std::max<long long>(1, options.expiryTick.count())) {}
+
+    BasicShardedCache(const BasicShardedCache&) = delete;
+    BasicShardedCache& operator=(const BasicShardedCache&) = delete;
+
+    /**
+     * Stores a key-value pair in the cache.
+     * Overwrites the value if the key already exists.
+     * In a bounded cache, older entries are evicted until the shard fits its budget;
+     * a pair larger than the whole shard budget is not stored.
+     * @param key The cache key (e.g., "user:123").
+     * @param value The value to store (e.g., user data, API response).
+     */
+    void put(std::string_view key, std::string_view value) {
+        checkStringKey(key);
+        store(key, value, 0);
+    }
+
+    /**
+     * Stores a key-value pair that expires after the given time-to-live.
+     * Overwrites the value and expiry if the key already exists.
+     * @param key The cache key (e.g., "api:/users/123").
+     * @param value The value to store.
+     * @param ttl How long the entry stays visible; must be positive.
+     */
+    void put(std::string_view key, std::string_view value, std::chrono::milliseconds ttl) {
+        checkStringKey(key);
+        storeFor(key, value, ttl);
+    }
+
+    /**
+     * Retrieves a copy of a value from the cache by key.
+     * @param key The cache key to look up.
+     * @return The value associated with the key, or empty string if not found.
+     */
+    std::string get(std::string_view key) {
+        checkStringKey(key);
+        return copyOf(key);
+    }
+
+    /**
+     * Retrieves a value without copying it.
+     * Costs one reference-count increment; prefer visit() for very hot keys
+     * shared by many threads, where even that increment contends.
+     * @param key The cache key to look up.
+     * @return A handle to the value, or an empty handle if not found.
+     */
+    ValueHandle getShared(std::string_view key) {
+        checkStringKey(key);
+        return handleOf(key);
+    }
+
+    /**
+     * Calls visitor(std::string_view value) on the stored value while the shard lock
+     * is held, so nothing is copied or reference-counted. The visitor must not call
+     * back into the cache and the view must not escape it.
+     * @param key The cache key to look up.
+     * @return True if the key was found and the visitor ran.
+     */
+    template <typename Visitor>
+    bool visit(std::string_view key, Visitor&& visitor) {
+        checkStringKey(key);
+        return visitStored(key, std::forward<Visitor>(visitor));
+    }
+
+    // Fixed-width keys; a caller building a string key per lookup can use these instead.
+
+    void put(const CacheKey128& key, std::string_view value) {
+        store(key.encode().view(), value, 0);
+    }
+
+    void put(const CacheKey128& key, std::string_view value, std::chrono::milliseconds ttl) {
+        storeFor(key.encode().view(), value, ttl);
+    }
+
+    std::string get(const CacheKey128& key) {
+        return copyOf(key.encode().view());
+    }
+
+    ValueHandle getShared(const CacheKey128& key) {
+        return handleOf(key.encode().view());
+    }
+
+    template <typename Visitor>
+    bool visit(const CacheKey128& key, Visitor&& visitor) {
+        return visitStored(key.encode().view(), std::forward<Visitor>(visitor));
+    }
+
+    /**
+     * Looks up many keys at once. Each key is hashed once, keys are grouped by shard
+     * so every shard lock is taken once per group, and the table slots of a group are
+     * prefetched before any of them is probed.
+     * @param keys The cache keys to look up.
+     * @param results Caller-supplied buffer with one handle per key, set to an empty
+     *                handle on a miss.
+     * @return The number of keys found.
+     */
+    size_t multiGet(std::span<const std::string_view> keys, std::span<ValueHandle> results) {
+        if (results.size() < keys.size()) {
+            throw std::invalid_argument("Result buffer is smaller than the key list");
+        }
+        for (std::string_view key : keys) {
+            checkStringKey(key);
+        }
+        size_t hits = 0;
+        forEachShardGroup(keys, [&](Shard& shard, const BatchKey* batch, size_t count) {
+            uint64_t fromSnapshot = 0; // bit i set when batch[i] was served from the snapshot
+            withShardReadLock(shard, [&] {
+                for (size_t i = 0; i < count; ++i) {
+                    shard.cache.prefetch(batch[i].hash);
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    Hit hit = lookup(shard, keys[batch[i].index], batch[i].hash);
+                    results[batch[i].index] = handleFor(shard, hit);
+                    hits += static_cast<bool>(hit);
+                    fromSnapshot |= uint64_t(hit.fromSnapshot) << i;
+                }
+            });
+            for (size_t i = 0; fromSnapshot != 0; ++i, fromSnapshot >>= 1) {
+                if (fromSnapshot & 1) {
+                    promote(shard, keys[batch[i].index], batch[i].hash);
+                }
+            }
+        });
+        return hits;
+    }
+
+    /**
+     * Stores many key-value pairs at once, taking each shard lock once per group of keys.
+     * Later pairs win when the same key appears twice.
+     * @param keys The cache keys.
+     * @param values One value per key.
+     */
+    void multiPut(std::span<const std::string_view> keys, std::span<const std::string_view> values) {
+        if (values.size() != keys.size()) {
+            throw std::invalid_argument("Key and value lists differ in length");
+        }
+        for (std::string_view key : keys) {
+            checkStringKey(key);
+        }
+        forEachShardGroup(keys, [&](Shard& shard, const BatchKey* batch, size_t count) {
+            std::unique_lock<ShardMutex> lock(shard.mutex);
+            if (shard.timers.size() > 0) {
+                expireDue(shard, kExpirySlotsPerWrite);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                shard.cache.prefetch(batch[i].hash);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                storeLocked(shard, keys[batch[i].index], batch[i].hash, values[batch[i].index], 0);
+            }
+            publishOccupancy(shard);
+            metrics.add(CacheMetrics::Puts, count);
+        });
+    }
+
+    /**
+     * Writes every live entry to a snapshot file that warmStart() can map later.
+     * Shards are written one at a time under a read lock, so the snapshot is consistent
+     * per shard but not across shards. Remaining time-to-live is kept as a wall-clock
+     * deadline, so entries still expire on time after a restart.
+     * @param path The snapshot file; replaced atomically once fully written.
+     * @return The number of entries written.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    size_t saveSnapshot(const std::string& path) {
+        SnapshotWriter writer(path);
+        long long steadyNow = nowMillis();
+        long long unixNow = SnapshotFormat::unixMillisNow();
+        for (size_t i = 0; i < shardCount; ++i) {
+            Shard& shard = shards[i];
+            std::shared_lock<ShardMutex> lock(shard.mutex);
+            shard.cache.forEach([&](std::string_view key, const Entry& entry) {
+                if (entry.expiresAt == 0) {
+                    writer.add(key, *entry.value, 0);
+                } else if (entry.expiresAt > steadyNow) {
+                    writer.add(key, *entry.value, entry.expiresAt - steadyNow + unixNow);
+                }
+            });
+            // Snapshot records not yet promoted are still part of the cache.
+            if (shard.snapshot) {
+                shard.snapshot->forEach([&](const MappedSnapshot::Record& record) {
+                    if (shardIndex(CacheKeyHash{}(record.key)) == i &&
+                        (record.expiresAt == 0 || record.expiresAt > unixNow)) {
+                        writer.add(record.key, record.value, record.expiresAt);
+                    }
+                });
+            }
+        }
+        return writer.finish();
+    }
+
+    /**
+     * Maps a snapshot written by saveSnapshot() and serves its entries without loading them.
+     * Only the header is read up front; a lookup that misses the in-memory table probes
+     * the mapped index, and a key found there is copied into the table on first use.
+     * Keys already in the cache keep their current value. A later warmStart() or
+     * clear() detaches the previous snapshot, dropping the entries it still held.
+     * @param path The snapshot file.
+     * @return The number of entries in the snapshot.
+     * @throws std::runtime_error if the file is missing or not a valid snapshot.
+     */
+    size_t warmStart(const std::string& path) {
+        std::shared_ptr<const MappedSnapshot> snapshot = MappedSnapshot::open(path);
+        for (size_t i = 0; i < shardCount; ++i) {
+            Shard& shard = shards[i];
+            std::unique_lock<ShardMutex> lock(shard.mutex);
+            shard.cache.forEach([&](std::string_view key, const Entry&) {
+                snapshot->supersede(key);
+            });
+            shard.snapshot = snapshot;
+        }
+        return snapshot->entryCount();
+    }
+
+    /**
+     * Reclaims every expired entry now instead of waiting for later writes.
+     */
+    void purgeExpired() {
+        for (size_t i = 0; i < shardCount; ++i) {
+            std::unique_lock<ShardMutex> lock(shards[i].mutex);
+            expireDue(shards[i], std::numeric_limits<size_t>::max());
+        }
+    }
+
+    /**
+     * Clears all entries in the cache.
+     */
+    void clear() {
+        auto locks = lockAllShards();
+        for (size_t i = 0; i < shardCount; ++i) {
+            Shard& shard = shards[i];
+            shard.cache.clear();
+            shard.lru.clear();
+            shard.clockRing.clear();
+            shard.freeClockSlots.clear();
+            shard.clockHand = 0;
+            shard.timers.clear();
+            shard.snapshot.reset();
+            shard.bytes = 0;
+            shard.arena.trim();
+            publishOccupancy(shard);
+        }
+    }
+
+    /**
+     * Gets the current size of the cache.
+     * All shards are locked together so the total reflects a single point in time.
+     * Expired entries count until they are reclaimed; snapshot entries count once
+     * they have been read and copied into memory.
+     * @return The number of key-value pairs in the cache.
+     */
+    size_t size() {
+        auto locks = lockAllShards();
+        size_t total = 0;
+        for (size_t i = 0; i < shardCount; ++i) {
+            total += shards[i].cache.size();
+        }
+        return total;
+    }
+
+    /**
+     * Gets the number of shards the cache was created with.
+     */
+    size_t getShardCount() const {
+        return shardCount;
+    }
+
+    /**
+     * Gets hit/miss/eviction counters and exact occupancy across all shards.
+     * Locks every shard; use getMetrics() for frequent polling.
+     */
+    CacheStats getStats() {
+        auto locks = lockAllShards();
+        MetricsSnapshot counters;
+        metrics.collect(counters);
+        CacheStats stats;
+        stats.hits = counters.hits;
+        stats.misses = counters.misses;
+        stats.evictions = counters.evictions;
+        stats.expirations = counters.expirations;
+        stats.snapshotHits = counters.snapshotHits;
+        for (size_t i = 0; i < shardCount; ++i) {
+            const Shard& shard = shards[i];
+            stats.entries += shard.cache.size();
+            stats.bytes += shard.bytes;
+            stats.reservedBytes += shard.arena.reservedBytes();
+            stats.systemAllocations += shard.arena.upstreamAllocations();
+        }
+        return stats;
+    }
+
+    /**
+     * Gets counters, sampled get/put latency histograms and approximate occupancy
+     * without taking any cache lock, so it is cheap enough to poll from a dashboard.
+     */
+    MetricsSnapshot getMetrics() const {
+        MetricsSnapshot snapshot;
+        metrics.collect(snapshot);
+        for (size_t i = 0; i < shardCount; ++i) {
+            snapshot.entries += shards[i].publishedEntries.load(std::memory_order_relaxed);
+            snapshot.bytes += shards[i].publishedBytes.load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+
+    /**
+     * Prints the cache contents.
+     * Every shard is read-locked while the live entries are copied out, so the
+     * listing is one consistent view; the locks are released before any output,
+     * so slow output never stalls other users of the cache. CacheKey128 keys
+     * are shown in hex.
+     */
+    void print() {
+        std::vector<std::pair<std::string, ValueHandle>> contents;
+        {
+            std::vector<std::shared_lock<ShardMutex>> locks;
+            locks.reserve(shardCount);
+            for (size_t i = 0; i < shardCount; ++i) {
+                locks.emplace_back(shards[i].mutex);
+            }
+            long long now = nowMillis();
+            for (size_t i = 0; i < shardCount; ++i) {
+                shards[i].cache.forEach([&](std::string_view key, const Entry& entry) {
+                    if (entry.expiresAt != 0 && entry.expiresAt <= now) {
+                        return;
+                    }
+                    contents.emplace_back(printableKey(key), ValueHandle(entry.value, *entry.value));
+                });
+            }
+        }
+        std::cout << "Cache Contents:\n";
+        for (const auto& [key, value] : contents) {
+            std::cout << "  Key: " << key << ", Value: " << value.view() << "\n";
+        }
+        if (contents.empty()) {
+            std::cout << "  (empty)\n";
+        }
+    }
+
+private:
+    /**
+     * A stored value plus the bookkeeping the eviction policy needs.
+     * Movable so that open-addressing tables can relocate it when they grow.
+     */
+    struct Entry {
+        std::shared_ptr<const std::pmr::string> value; // immutable once stored; shared with ValueHandles
+        long long expiresAt = 0;                      // steady-clock milliseconds; 0 = never expires
+        std::pmr::list<std::pmr::string>::iterator lruPos; // position in Shard::lru (LRU only)
+        size_t clockSlot = 0;                    // index in Shard::clockRing (Clock only)
+        mutable std::atomic<bool> referenced{false}; // Clock second-chance bit, set by readers
+
+        Entry() = default;
+        Entry(Entry&& other) noexcept
+            : value(std::move(other.value)), expiresAt(other.expiresAt), lruPos(other.lruPos),
+              clockSlot(other.clockSlot), referenced(other.referenced.load(std::memory_order_relaxed)) {}
+    };
+
+    /**
+     * One independently locked slice of the key space.
+     * Its containers, keys and values all allocate from the shard's arena.
+     */
+    struct Shard {
+        SlabArena arena; // declared first so it outlives everything allocated from it
+        Table<Entry> cache{&arena};
+        ShardMutex mutex; // protects everything below except the atomic counters
+        size_t bytes = 0;
+        size_t budget = 0;
+
+        std::pmr::list<std::pmr::string> lru{&arena};         // most recently used at the front
+        std::pmr::vector<std::pmr::string> clockRing{&arena}; // keys in insertion slots; empty string marks a free slot
+        std::pmr::vector<size_t> freeClockSlots{&arena};
+        size_t clockHand = 0;
+
+        TimerWheel timers{&arena}; // expiry schedule for entries with a time-to-live
+        std::shared_ptr<const MappedSnapshot> snapshot; // warm-start entries not yet in the table
+
+        // Occupancy as of the last write, readable without the lock.
+        std::atomic<size_t> publishedEntries{0};
+        std::atomic<size_t> publishedBytes{0};
+    };
+
+    /**
+     * Result of a lookup: a live table entry, a value served from the snapshot, or a miss.
+     */
+    struct Hit {
+        const Entry* entry = nullptr;
+        bool fromSnapshot = false;
+        std::string_view snapshotValue; // points into the shard's mapped snapshot
+
+        explicit operator bool() const { return entry != nullptr || fromSnapshot; }
+        std::string_view value() const { return entry ? std::string_view(*entry->value) : snapshotValue; }
+    };
+
+    // Timer slots reclaimed per write, keeping the time spent under the shard lock short.
+    static constexpr size_t kExpirySlotsPerWrite = 8;
+
+    // Keys a batch operation hashes and sorts at a time, in a stack buffer.
+    static constexpr size_t kBatchChunk = 64;
+
+    // A key of a batch operation: its position in the caller's list, hash and shard.
+    struct BatchKey {
+        size_t index;
+        size_t hash;
+        size_t shard;
+    };
+
+    static long long nowMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Keeps string keys out of the encoded CacheKey128 keyspace.
+    static void checkStringKey(std::string_view key) {
+        if (!key.empty() && key.front() == CacheKey128::kTag) {
+            throw std::invalid_argument("Keys starting with a NUL byte are reserved for CacheKey128");
+        }
+    }
+
+    // The lookups and TTL writes behind the public methods, on keys already in stored form.
+
+    void storeFor(std::string_view key, std::string_view value, std::chrono::milliseconds ttl) {
+        if (ttl.count() <= 0) {
+            throw std::invalid_argument("Time-to-live must be positive");
+        }
+        store(key, value, nowMillis() + ttl.count());
+    }
+
+    std::string copyOf(std::string_view key) {
+        return withReadLock<std::string>(key, [](Shard&, const Hit& hit) {
+            return hit ? std::string(hit.value()) : std::string(); // or throw or use std::optional in C++17+
+        });
+    }
+
+    ValueHandle handleOf(std::string_view key) {
+        return withReadLock<ValueHandle>(key, [](Shard& shard, const Hit& hit) {
+            return handleFor(shard, hit);
+        });
+    }
+
+    template <typename Visitor>
+    bool visitStored(std::string_view key, Visitor&& visitor) {
+        return withReadLock<bool>(key, [&](Shard&, const Hit& hit) {
+            if (hit) {
+                visitor(hit.value());
+            }
+            return static_cast<bool>(hit);
+        });
+    }
+
+    /**
+     * Writes an entry under the shard lock; expiresAt is 0 for entries that never expire.
+     */
+    void store(std::string_view key, std::string_view value, long long expiresAt) {
+        if (key.empty()) {
+            throw std::invalid_argument("Cache key cannot be empty");
+        }
+        size_t hash = CacheKeyHash{}(key);
+        Shard& shard = shardFor(hash);
+        bool sampled = metrics.shouldSample();
+        unsigned long long start = sampled ? CacheMetrics::nowNanos() : 0;
+        {
+            std::unique_lock<ShardMutex> lock(shard.mutex);
+            if (shard.timers.size() > 0 || expiresAt != 0) {
+                expireDue(shard, kExpirySlotsPerWrite);
+            }
+            storeLocked(shard, key, hash, value, expiresAt);
+            publishOccupancy(shard);
+        }
+        metrics.add(CacheMetrics::Puts);
+        if (sampled) {
+            metrics.recordPut(CacheMetrics::nowNanos() - start);
+        }
+    }
+
+    // Writes an entry into a shard whose lock the caller holds exclusively.
+    void storeLocked(Shard& shard, std::string_view key, size_t hash, std::string_view value, long long expiresAt) {
+        Entry* entry = shard.cache.find(key, hash);
+        bool inserted = entry == nullptr;
+        if (inserted) {
+            entry = shard.cache.insert(key, hash);
+        } else {
+            shard.bytes -= key.size() + entry->value->size();
+        }
+        entry->value = std::allocate_shared<std::pmr::string>(
+            std::pmr::polymorphic_allocator<std::pmr::string>(&shard.arena), value);
+        entry->expiresAt = expiresAt;
+        shard.bytes += key.size() + value.size();
+        if (shard.snapshot) {
+            shard.snapshot->supersede(key); // an evicted newer value must not fall back to it
+        }
+        if (expiresAt != 0) {
+            shard.timers.schedule(key, (expiresAt + tickMillis - 1) / tickMillis);
+        }
+        if (!bounded) {
+            return;
+        }
+        if (inserted) {
+            track(shard, key, *entry);
+        } else {
+            touch(shard, *entry);
+        }
+        evictOverBudget(shard, key, hash);
+    }
+
+    /**
+     * Advances the shard's timer wheel to now and removes entries that have expired.
+     * Timers whose entry was rewritten or removed since are skipped.
+     */
+    void expireDue(Shard& shard, size_t maxSlots) {
+        long long now = nowMillis();
+        shard.timers.advance(now / tickMillis, maxSlots, [&](std::string_view key) {
+            size_t hash = CacheKeyHash{}(key);
+            Entry* entry = shard.cache.find(key, hash);
+            if (entry && entry->expiresAt != 0 && entry->expiresAt <= now) {
+                erase(shard, key, hash, *entry);
+                metrics.add(CacheMetrics::Expirations);
+            }
+        });
+        publishOccupancy(shard);
+    }
+
+    // Copies the shard's occupancy where getMetrics() can read it; the caller holds the lock.
+    static void publishOccupancy(Shard& shard) {
+        shard.publishedEntries.store(shard.cache.size(), std::memory_order_relaxed);
+        shard.publishedBytes.store(shard.bytes, std::memory_order_relaxed);
+    }
+
+    static std::unique_ptr<Shard[]> makeShards(const Options& options, CacheMetrics& metrics) {
+        if (options.shardCount == 0) {
+            throw std::invalid_argument("Shard count must be at least 1");
+        }
+        std::unique_ptr<Shard[]> result(new Shard[options.shardCount]);
+        for (size_t i = 0; i < options.shardCount; ++i) {
+            result[i].mutex.setSharedReads(options.concurrency == ConcurrencyMode::SharedRead);
+            result[i].mutex.setMetrics(&metrics);
+            result[i].arena.setPooling(options.storage == StorageMode::Arena);
+            result[i].budget = std::max<size_t>(1, options.maxBytes / options.shardCount);
+        }
+        return result;
+    }
+
+    // Picks the shard from the high bits of the hash; the tables consume the low bits.
+    size_t shardIndex(size_t hash) const {
+        return (hash >> 40) % shardCount;
+    }
+
+    Shard& shardFor(size_t hash) {
+        return shards[shardIndex(hash)];
+    }
+
+    /**
+     * Locks the key's shard for reading and passes the lookup result to fn(shard, hit).
+     * The lock is shared unless the eviction policy reorders entries on a hit.
+     * A value served from the snapshot is promoted into the table once the lock is released.
+     */
+    template <typename Result, typename Fn>
+    Result withReadLock(std::string_view key, Fn&& fn) {
+        if (key.empty()) {
+            throw std::invalid_argument("Cache key cannot be empty");
+        }
+        size_t hash = CacheKeyHash{}(key);
+        Shard& shard = shardFor(hash);
+        bool sampled = metrics.shouldSample();
+        unsigned long long start = sampled ? CacheMetrics::nowNanos() : 0;
+        bool fromSnapshot = false;
+        Result result = withShardReadLock(shard, [&]() -> Result {
+            Hit hit = lookup(shard, key, hash);
+            fromSnapshot = hit.fromSnapshot;
+            return fn(shard, hit);
+        });
+        if (fromSnapshot) {
+            promote(shard, key, hash);
+        }
+        if (sampled) {
+            metrics.recordGet(CacheMetrics::nowNanos() - start);
+        }
+        return result;
+    }
+
+    // Wraps a lookup result in a handle that keeps the value's storage alive.
+    static ValueHandle handleFor(const Shard& shard, const Hit& hit) {
+        if (hit.entry) {
+            return ValueHandle(hit.entry->value, *hit.entry->value);
+        }
+        return hit.fromSnapshot ? ValueHandle(shard.snapshot, hit.snapshotValue) : ValueHandle();
+    }
+
+    /**
+     * Copies a snapshot record into the table after it was read, so later reads take
+     * the in-memory path and the entry joins eviction and expiry like any other.
+     * Does nothing if another thread promoted or rewrote the key in the meantime.
+     */
+    void promote(Shard& shard, std::string_view key, size_t hash) {
+        std::unique_lock<ShardMutex> lock(shard.mutex);
+        MappedSnapshot::Record record;
+        if (!shard.snapshot || shard.cache.find(key, hash) || !shard.snapshot->find(key, record)) {
+            return;
+        }
+        long long expiresAt = 0;
+        if (record.expiresAt != 0) {
+            long long now = nowMillis();
+            expiresAt = record.expiresAt - SnapshotFormat::unixMillisNow() + now;
+            if (expiresAt <= now) {
+                return;
+            }
+        }
+        storeLocked(shard, key, hash, record.value, expiresAt);
+        publishOccupancy(shard);
+    }
+
+    /**
+     * Runs fn with the shard locked for reading: shared, unless the eviction policy
+     * reorders entries on a hit.
+     */
+    template <typename Fn>
+    decltype(auto) withShardReadLock(Shard& shard, Fn&& fn) {
+        if (bounded && policy == EvictionPolicy::LRU) {
+            std::unique_lock<ShardMutex> lock(shard.mutex);
+            return fn();
+        }
+        std::shared_lock<ShardMutex> lock(shard.mutex);
+        return fn();
+    }
+
+    /**
+     * Hashes the keys of a batch in chunks, sorts each chunk by shard and calls
+     * fn(shard, keys, count) once per run of keys that share a shard.
+     * Works entirely in stack buffers, so batches allocate nothing.
+     */
+    template <typename Fn>
+    void forEachShardGroup(std::span<const std::string_view> keys, Fn&& fn) {
+        for (std::string_view key : keys) {
+            if (key.empty()) {
+                throw std::invalid_argument("Cache key cannot be empty");
+            }
+        }
+        BatchKey chunk[kBatchChunk];
+        for (size_t start = 0; start < keys.size(); start += kBatchChunk) {
+            size_t count = std::min(kBatchChunk, keys.size() - start);
+            for (size_t i = 0; i < count; ++i) {
+                size_t hash = CacheKeyHash{}(keys[start + i]);
+                chunk[i] = BatchKey{start + i, hash, shardIndex(hash)};
+            }
+            // Insertion sort: stable, so repeated keys keep the caller's order, and allocation-free.
+            for (size_t i = 1; i < count; ++i) {
+                BatchKey key = chunk[i];
+                size_t j = i;
+                for (; j > 0 && chunk[j - 1].shard > key.shard; --j) {
+                    chunk[j] = chunk[j - 1];
+                }
+                chunk[j] = key;
+            }
+            for (size_t first = 0; first < count;) {
+                size_t last = first + 1;
+                while (last < count && chunk[last].shard == chunk[first].shard) {
+                    ++last;
+                }
+                fn(shards[chunk[first].shard], chunk + first, last - first);
+                first = last;
+            }
+        }
+    }
+
+    /**
+     * Finds a live entry, falling back to the snapshot when the table has none,
+     * and records the hit or miss; the caller holds the shard lock.
+     */
+    Hit lookup(Shard& shard, std::string_view key, size_t hash) {
+        const Entry* entry = shard.cache.find(key, hash);
+        if (entry && (entry->expiresAt == 0 || entry->expiresAt > nowMillis())) {
+            metrics.add(CacheMetrics::Hits);
+            if (bounded) {
+                touch(shard, *entry);
+            }
+            return Hit{entry, false, {}};
+        }
+        MappedSnapshot::Record record;
+        if (!entry && shard.snapshot && shard.snapshot->find(key, record) &&
+            (record.expiresAt == 0 || record.expiresAt > SnapshotFormat::unixMillisNow())) {
+            metrics.add(CacheMetrics::Hits);
+            metrics.add(CacheMetrics::SnapshotHits);
+            return Hit{nullptr, true, record.value};
+        }
+        metrics.add(CacheMetrics::Misses);
+        return Hit{};
+    }
+
+    // Registers a newly inserted entry with the eviction policy.
+    void track(Shard& shard, std::string_view key, Entry& entry) {
+        if (policy == EvictionPolicy::LRU) {
+            shard.lru.emplace_front(key);
+            entry.lruPos = shard.lru.begin();
+        } else if (!shard.freeClockSlots.empty()) {
+            entry.clockSlot = shard.freeClockSlots.back();
+            shard.freeClockSlots.pop_back();
+            shard.clockRing[entry.clockSlot] = key;
+        } else {
+            entry.clockSlot = shard.clockRing.size();
+            shard.clockRing.emplace_back(key);
+        }
+    }
+
+    // Marks an entry as recently used.
+    void touch(Shard& shard, const Entry& entry) {
+        if (policy == EvictionPolicy::LRU) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, entry.lruPos);
+        } else {
+            entry.referenced.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Removes an entry from the table and from the eviction policy's bookkeeping.
+     * The key may point into that bookkeeping, so the table entry goes first.
+     */
+    void erase(Shard& shard, std::string_view key, size_t hash, Entry& entry) {
+        shard.bytes -= key.size() + entry.value->size();
+        auto lruPos = entry.lruPos;
+        size_t clockSlot = entry.clockSlot;
+        shard.cache.erase(key, hash);
+        if (bounded && policy == EvictionPolicy::LRU) {
+            shard.lru.erase(lruPos);
+        } else if (bounded) {
+            shard.clockRing[clockSlot].clear();
+            shard.freeClockSlots.push_back(clockSlot);
+        }
+    }
+
+    /**
+     * Evicts entries until the shard fits its budget. The entry just written is
+     * kept unless it alone exceeds the budget.
+     */
+    void evictOverBudget(Shard& shard, std::string_view justWritten, size_t justWrittenHash) {
+        if (shard.bytes <= shard.budget) {
+            return;
+        }
+        while (shard.bytes > shard.budget && shard.cache.size() > 1) {
+            std::string_view victim = pickVictim(shard, justWritten);
+            size_t hash = CacheKeyHash{}(victim);
+            erase(shard, victim, hash, *shard.cache.find(victim, hash));
+            metrics.add(CacheMetrics::Evictions);
+        }
+        if (shard.bytes > shard.budget) {
+            erase(shard, justWritten, justWrittenHash, *shard.cache.find(justWritten, justWrittenHash));
+        }
+        shard.arena.trim(); // evictions may have emptied whole slabs
+    }
+
+    /**
+     * Chooses the next key to evict; the shard holds at least one entry besides `keep`.
+     * The returned view points into the policy's bookkeeping.
+     */
+    std::string_view pickVictim(Shard& shard, std::string_view keep) {
+        if (policy == EvictionPolicy::LRU) {
+            std::string_view victim = shard.lru.back();
+            return victim == keep ? std::string_view(*std::next(shard.lru.rbegin())) : victim;
+        }
+        // Sweep the clock hand, giving referenced entries a second chance.
+        for (;; shard.clockHand = (shard.clockHand + 1) % shard.clockRing.size()) {
+            std::string_view slotKey = shard.clockRing[shard.clockHand];
+            if (slotKey.empty() || slotKey == keep) {
+                continue;
+            }
+            const Entry* entry = shard.cache.find(slotKey, CacheKeyHash{}(slotKey));
+            if (!entry->referenced.exchange(false, std::memory_order_relaxed)) {
+                return slotKey;
+            }
+        }
+    }
+
+    // Returns a stored key as text, with CacheKey128 keys as 0x-prefixed hex of their words.
+    static std::string printableKey(std::string_view key) {
+        std::optional<CacheKey128> binary = CacheKey128::decode(key);
+        if (!binary) {
+            return std::string(key);
+        }
+        char text[2 + 32 + 1];
+        std::snprintf(text, sizeof(text), "0x%016llx%016llx",
+                      static_cast<unsigned long long>(binary->high),
+                      static_cast<unsigned long long>(binary->low));
+        return text;
+    }
+
+    /**
+     * Locks every shard in index order, so concurrent callers cannot deadlock.
+     */
+    std::vector<std::unique_lock<ShardMutex>> lockAllShards() {
+        std::vector<std::unique_lock<ShardMutex>> locks;
+        locks.reserve(shardCount);
+        for (size_t i = 0; i < shardCount; ++i) {
+            locks.emplace_back(shards[i].mutex);
+        }
+        return locks;
+    }
+
+    CacheMetrics metrics; // declared before the shards, whose locks report into it
+    std::unique_ptr<Shard[]> shards;
+    size_t shardCount;
+    bool bounded;
+    EvictionPolicy policy;
+    long long tickMillis;
+};
+
+// The default, node-based cache.
+using ShardedCache = BasicShardedCache<NodeTable>;
+
+// A cache whose shards use open addressing with inline short keys.
+using FlatShardedCache = BasicShardedCache<FlatTable>;
+
+/**
+ * A Singleton class that manages a single in-memory cache for key-value pairs.
+ * Ensures only one cache instance exists, providing global access to store and retrieve data.
+ * Useful in scenarios like caching database results or API responses to improve performance.
+ * Uses lazy initialization with thread-safe std::call_once.
+ * Each storage engine gets its own singleton: BasicCacheManager<FlatTable> is a
+ * separate instance from CacheManager.
+ */
+template <template <typename> class Table = NodeTable>
+class BasicCacheManager : public BasicShardedCache<Table> {
+public:
+    using Options = typename BasicShardedCache<Table>::Options;
+
+    // Delete copy constructor and assignment operator to prevent copies
+    BasicCacheManager(const BasicCacheManager&) = delete;
+    BasicCacheManager& operator=(const BasicCacheManager&) = delete;
+
+    /**
+     * Gets the single instance of CacheManager, creating it if necessary.
+     * After the first call this is one acquire load of an already published pointer;
+     * std::call_once runs only while the instance is being created.
+     * @return Reference to the single CacheManager instance.
+     */
+    static BasicCacheManager& getInstance() {
+        if (BasicCacheManager* ready = instance.load(std::memory_order_acquire)) [[likely]] {
+            return *ready;
+        }
+        return createInstance(Options{});
+    }
+
+    /**
+     * Gets the single instance of CacheManager, creating it with the given options
+     * if this is the first call.
+     * @param options Settings used only if the instance does not exist yet.
+     * @return Reference to the single CacheManager instance.
+     */
+    static BasicCacheManager& getInstance(const Options& options) {
+        if (BasicCacheManager* ready = instance.load(std::memory_order_acquire)) [[likely]] {
+            return *ready;
+        }
+        return createInstance(options);
+    }
+
+private:
+    explicit BasicCacheManager(const Options& options) : BasicShardedCache<Table>(options) {} // Private constructor
+
+    /**
+     * Slow path of getInstance(): constructs the instance in static storage, once.
+     * The instance is never destroyed, so it stays usable from other static
+     * destructors and from threads still running at exit.
+     */
+    [[gnu::noinline]] static BasicCacheManager& createInstance(const Options& options) {
+        std::call_once(initInstanceFlag, [&options] {
+            alignas(BasicCacheManager) static unsigned char storage[sizeof(BasicCacheManager)];
+            instance.store(::new (storage) BasicCacheManager(options), std::memory_order_release);
+        });
+        return *instance.load(std::memory_order_acquire);
+    }
+
+    // Static member initialization
+    static inline std::atomic<BasicCacheManager*> instance{nullptr}; // set once, after construction completes
+    static inline std::once_flag initInstanceFlag;
+};
+
+using CacheManager = BasicCacheManager<>;
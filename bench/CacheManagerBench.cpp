@@ -0,0 +1,188 @@
+#include "SingletonPattern.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> makeKeys(size_t count) {
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys.push_back("user:" + std::to_string(i));
+    }
+    return keys;
+}
+
+// xorshift32: cheap per-thread key picker that doesn't touch shared state.
+unsigned nextRandom(unsigned& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/**
+ * Read-heavy traffic (98% get, 2% put) over 1024 hot keys in one shard, shared by
+ * every benchmark thread. Arg 0 selects the concurrency mode: 0 = exclusive, 1 = shared-read.
+ */
+void BM_CacheReadHeavy(benchmark::State& state) {
+    static std::unique_ptr<ShardedCache> cache;
+    static std::vector<std::string> keys;
+    if (state.thread_index() == 0) {
+        auto mode = state.range(0) ? ShardedCache::ConcurrencyMode::SharedRead : ShardedCache::ConcurrencyMode::Exclusive;
+        cache = std::make_unique<ShardedCache>(ShardedCache::Options{/*shardCount=*/1, mode});
+        keys = makeKeys(1024);
+        for (const std::string& key : keys) {
+            cache->put(key, "value");
+        }
+    }
+    unsigned rng = 2463534242u + unsigned(state.thread_index());
+    for (auto _ : state) {
+        const std::string& key = keys[nextRandom(rng) % keys.size()];
+        if (rng % 50 == 0) {
+            cache->put(key, "updated");
+        } else {
+            benchmark::DoNotOptimize(cache->get(key));
+        }
+    }
+    if (state.thread_index() == 0) {
+        cache.reset();
+    }
+}
+BENCHMARK(BM_CacheReadHeavy)->ArgName("shared")->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
+
+/**
+ * Puts only, from every benchmark thread into one cache; Arg 0 is the shard count.
+ */
+void BM_CachePutContended(benchmark::State& state) {
+    static std::unique_ptr<ShardedCache> cache;
+    static std::vector<std::string> keys;
+    if (state.thread_index() == 0) {
+        cache = std::make_unique<ShardedCache>(ShardedCache::Options{size_t(state.range(0))});
+        keys = makeKeys(4096);
+    }
+    unsigned rng = 88675123u + unsigned(state.thread_index());
+    for (auto _ : state) {
+        cache->put(keys[nextRandom(rng) % keys.size()], "value");
+    }
+    if (state.thread_index() == 0) {
+        cache.reset();
+    }
+}
+BENCHMARK(BM_CachePutContended)->ArgName("shards")->Arg(1)->Arg(16)->ThreadRange(1, 8)->UseRealTime();
+
+/**
+ * Churns a bounded cache (1 MiB budget, 20k keys, 20-620 byte values) and reports
+ * the allocations its storage requests from the system per put.
+ * Arg 0 selects the storage: 0 = heap, 1 = arena.
+ */
+void BM_CacheChurnAllocations(benchmark::State& state) {
+    auto storage = state.range(0) ? ShardedCache::StorageMode::Arena : ShardedCache::StorageMode::Heap;
+    ShardedCache cache({/*shardCount=*/4, ShardedCache::ConcurrencyMode::Exclusive,
+                        /*maxBytes=*/1 << 20, ShardedCache::EvictionPolicy::LRU,
+                        std::chrono::milliseconds(10), storage});
+    std::vector<std::string> keys = makeKeys(20000);
+    std::vector<std::string> values;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        values.push_back(std::string(20 + (i * 37) % 600, 'v'));
+    }
+    size_t i = 0;
+    unsigned long long before = cache.getStats().systemAllocations;
+    for (auto _ : state) {
+        size_t k = (i++ * 7919) % keys.size();
+        cache.put(keys[k], values[k]);
+    }
+    CacheStats after = cache.getStats();
+    state.counters["allocs/put"] = benchmark::Counter(double(after.systemAllocations - before), benchmark::Counter::kAvgIterations);
+    state.counters["reservedKiB"] = double(after.reservedBytes) / 1024;
+}
+BENCHMARK(BM_CacheChurnAllocations)->ArgName("arena")->Arg(0)->Arg(1);
+
+/**
+ * Random lookups over 1M short keys in one shard, for each storage engine.
+ */
+template <typename Cache>
+void BM_CacheLookup(benchmark::State& state) {
+    static const std::vector<std::string> keys = makeKeys(1000000);
+    static Cache* cache = [] {
+        auto* filled = new Cache({/*shardCount=*/1});
+        for (const std::string& key : keys) {
+            filled->put(key, "v");
+        }
+        return filled;
+    }();
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache->visit(keys[(i++ * 2654435761u) % keys.size()], [](std::string_view) {}));
+    }
+}
+BENCHMARK(BM_CacheLookup<ShardedCache>)->Name("BM_CacheLookup/node");
+BENCHMARK(BM_CacheLookup<FlatShardedCache>)->Name("BM_CacheLookup/flat");
+
+/**
+ * 32 keys over 16 shards, fetched one getShared() at a time (Arg 0 = 0) or with
+ * one multiGet() (Arg 0 = 1).
+ */
+void BM_CacheBatchedGet(benchmark::State& state) {
+    static const std::vector<std::string> keys = makeKeys(100000);
+    static FlatShardedCache* cache = [] {
+        auto* filled = new FlatShardedCache({/*shardCount=*/16});
+        for (const std::string& key : keys) {
+            filled->put(key, "profile");
+        }
+        return filled;
+    }();
+    constexpr size_t kBatch = 32;
+    std::string_view batch[kBatch];
+    ValueHandle results[kBatch];
+    size_t b = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < kBatch; ++i) {
+            batch[i] = keys[(b * kBatch + i) * 7919 % keys.size()];
+        }
+        ++b;
+        if (state.range(0)) {
+            cache->multiGet(batch, results);
+        } else {
+            for (size_t i = 0; i < kBatch; ++i) {
+                results[i] = cache->getShared(batch[i]);
+            }
+        }
+        benchmark::DoNotOptimize(results);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * kBatch));
+}
+BENCHMARK(BM_CacheBatchedGet)->ArgName("multiGet")->Arg(0)->Arg(1);
+
+/**
+ * The earlier getInstance(), which ran std::call_once on every call and returned
+ * a heap-allocated instance; kept only as the baseline for BM_GetInstance.
+ */
+CacheManager& getInstanceByCallOnce() {
+    static std::once_flag initialized;
+    static CacheManager* instance = nullptr;
+    std::call_once(initialized, [] { instance = &CacheManager::getInstance(); });
+    return *instance;
+}
+
+void BM_GetInstanceCallOnce(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&getInstanceByCallOnce());
+    }
+}
+BENCHMARK(BM_GetInstanceCallOnce)->ThreadRange(1, 8);
+
+void BM_GetInstance(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&CacheManager::getInstance());
+    }
+}
+BENCHMARK(BM_GetInstance)->ThreadRange(1, 8);
+
+} // namespace
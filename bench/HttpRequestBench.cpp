@@ -0,0 +1,437 @@
+#include "BuilderPattern.hpp"
+#include "SingletonPattern.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Counts this thread's heap allocations so benchmarks can report them per operation.
+static thread_local size_t heapAllocations = 0;
+
+void* operator new(size_t size) {
+    ++heapAllocations;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+// GCC pairs the free() below with the operator new above and warns about a mismatch.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+struct Field {
+    std::string name;
+    std::string value;
+};
+
+std::vector<Field> makeHeaders(size_t count) {
+    std::vector<Field> headers;
+    for (size_t i = 0; i < count; ++i) {
+        headers.push_back({"X-Header-" + std::to_string(i), "value-" + std::to_string(i * 7919)});
+    }
+    return headers;
+}
+
+HttpRequest buildRequest(const std::vector<Field>& headers) {
+    HttpRequest::Builder builder("https://api.example.com/v1/users", "POST");
+    for (const Field& header : headers) {
+        builder.addHeader(header.name, header.value);
+    }
+    return std::move(builder)
+        .addQueryParam("page", "2")
+        .addQueryParam("limit", "50")
+        .setBody("{\"name\": \"Alice\", \"role\": \"admin\"}")
+        .build();
+}
+
+/**
+ * Builds a request with Arg 0 headers, two query parameters and a small body.
+ */
+void BM_BuildRequest(benchmark::State& state) {
+    std::vector<Field> headers = makeHeaders(size_t(state.range(0)));
+    size_t before = heapAllocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buildRequest(headers));
+    }
+    state.counters["allocs"] = benchmark::Counter(double(heapAllocations - before), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_BuildRequest)->ArgName("headers")->Arg(0)->Arg(4)->Arg(16)->Arg(64);
+
+/**
+ * Builds the same requests as BM_BuildRequest with every part taken from a
+ * per-request monotonic arena, released with one call after each request.
+ */
+void BM_BuildRequestInArena(benchmark::State& state) {
+    std::vector<Field> headers = makeHeaders(size_t(state.range(0)));
+    std::vector<std::byte> buffer(64 * 1024);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+    std::pmr::polymorphic_allocator<char> allocator(&arena);
+    size_t before = heapAllocations;
+    for (auto _ : state) {
+        {
+            PmrHttpRequest::Builder builder("https://api.example.com/v1/users", "POST", allocator);
+            for (const Field& header : headers) {
+                builder.addHeader(header.name, header.value);
+            }
+            benchmark::DoNotOptimize(std::move(builder)
+                                         .addQueryParam("page", "2")
+                                         .addQueryParam("limit", "50")
+                                         .setBody(PmrHttpRequest::String("{\"name\": \"Alice\", \"role\": \"admin\"}", allocator))
+                                         .build());
+        }
+        arena.release();
+    }
+    state.counters["allocs"] = benchmark::Counter(double(heapAllocations - before), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_BuildRequestInArena)->ArgName("headers")->Arg(0)->Arg(4)->Arg(16)->Arg(64);
+
+/**
+ * Builds requests from a template holding Arg 0 common headers and two query
+ * parameters, adding one per-request header.
+ */
+void BM_BuildFromTemplate(benchmark::State& state) {
+    HttpRequestTemplate common = [&] {
+        HttpRequest::Builder builder("https://api.example.com/v1/users", "POST");
+        for (const Field& header : makeHeaders(size_t(state.range(0)))) {
+            builder.addHeader(header.name, header.value);
+        }
+        return std::move(builder).addQueryParam("page", "2").addQueryParam("limit", "50").freeze();
+    }();
+    size_t before = heapAllocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(common.request().addHeader("X-Request-Id", "8d2f").build());
+    }
+    state.counters["allocs"] = benchmark::Counter(double(heapAllocations - before), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_BuildFromTemplate)->ArgName("headers")->Arg(0)->Arg(4)->Arg(16)->Arg(64);
+
+/**
+ * Builds a request with the usual well-known headers through the runtime Builder,
+ * as the baseline for BM_BuildTyped.
+ */
+void BM_BuildKnownHeaders(benchmark::State& state) {
+    size_t before = heapAllocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HttpRequest::Builder("https://api.example.com/v1/users", "POST")
+                                     .addHeader("Content-Type", "application/json")
+                                     .addHeader("Authorization", "Bearer abc123")
+                                     .addHeader("Accept", "application/json")
+                                     .addHeader("User-Agent", "fanout/1.0")
+                                     .setBody("{\"name\": \"Alice\"}")
+                                     .build());
+    }
+    state.counters["allocs"] = benchmark::Counter(double(heapAllocations - before), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_BuildKnownHeaders);
+
+/**
+ * Builds the same request through TypedBuilder with precomputed header names.
+ */
+void BM_BuildTyped(benchmark::State& state) {
+    size_t before = heapAllocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HttpRequest::TypedBuilder<HttpMethod::Post>()
+                                     .url("https://api.example.com/v1/users")
+                                     .header(KnownHeaders::ContentType, "application/json")
+                                     .header(KnownHeaders::Authorization, "Bearer abc123")
+                                     .header(KnownHeaders::Accept, "application/json")
+                                     .header(KnownHeaders::UserAgent, "fanout/1.0")
+                                     .body("{\"name\": \"Alice\"}")
+                                     .build());
+    }
+    state.counters["allocs"] = benchmark::Counter(double(heapAllocations - before), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_BuildTyped);
+
+/**
+ * Builds requests with an Arg 0 byte body from one reusable builder; each build() copies the body.
+ */
+void BM_BuildCopyingBody(benchmark::State& state) {
+    HttpRequest::Builder builder("https://api.example.com/v1/upload", "PUT");
+    builder.addHeader("Content-Type", "application/json").setBody(std::string(size_t(state.range(0)), 'x'));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(builder.build());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations() * state.range(0)));
+}
+BENCHMARK(BM_BuildCopyingBody)->ArgName("bodyBytes")->Arg(1 << 20)->Arg(16 << 20);
+
+/**
+ * Builds the same requests through a temporary builder chain, which moves the body into the request.
+ */
+void BM_BuildMovingBody(benchmark::State& state) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::string body(size_t(state.range(0)), 'x');
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(HttpRequest::Builder("https://api.example.com/v1/upload", "PUT")
+                                     .addHeader("Content-Type", "application/json")
+                                     .setBody(std::move(body))
+                                     .build());
+    }
+    state.SetBytesProcessed(int64_t(state.iterations() * state.range(0)));
+}
+BENCHMARK(BM_BuildMovingBody)->ArgName("bodyBytes")->Arg(1 << 20)->Arg(16 << 20);
+
+/**
+ * Formats an already built request with Arg 0 headers through toString().
+ */
+void BM_SerializeRequest(benchmark::State& state) {
+    HttpRequest request = buildRequest(makeHeaders(size_t(state.range(0))));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::string text = request.toString();
+        bytes += text.size();
+        benchmark::DoNotOptimize(text);
+    }
+    state.SetBytesProcessed(int64_t(bytes));
+}
+BENCHMARK(BM_SerializeRequest)->ArgName("headers")->Arg(0)->Arg(4)->Arg(16)->Arg(64);
+
+/**
+ * Serializes the same request in wire format into one reused buffer.
+ */
+void BM_SerializeWire(benchmark::State& state) {
+    HttpRequest request = buildRequest(makeHeaders(size_t(state.range(0))));
+    std::string buffer;
+    size_t before = heapAllocations;
+    for (auto _ : state) {
+        buffer.clear();
+        request.serializeTo(buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.counters["allocs"] = benchmark::Counter(double(heapAllocations - before), benchmark::Counter::kAvgIterations);
+    state.SetBytesProcessed(int64_t(state.iterations() * buffer.size()));
+}
+BENCHMARK(BM_SerializeWire)->ArgName("headers")->Arg(0)->Arg(4)->Arg(16)->Arg(64);
+
+/**
+ * Parses the wire form of a request with Arg 0 headers in place.
+ */
+void BM_ParseRequest(benchmark::State& state) {
+    std::string wire = buildRequest(makeHeaders(size_t(state.range(0)))).toWire();
+    HttpRequestParser parser;
+    size_t before = heapAllocations;
+    for (auto _ : state) {
+        parser.reset();
+        if (parser.parse(wire) != HttpRequestParser::Status::Done) {
+            state.SkipWithError(parser.error());
+            break;
+        }
+        benchmark::DoNotOptimize(parser.view().getBody().data());
+    }
+    state.counters["allocs"] = benchmark::Counter(double(heapAllocations - before), benchmark::Counter::kAvgIterations);
+    state.SetBytesProcessed(int64_t(state.iterations() * wire.size()));
+}
+BENCHMARK(BM_ParseRequest)->ArgName("headers")->Arg(0)->Arg(4)->Arg(16)->Arg(64);
+
+/**
+ * Sends a request with an Arg 0 byte body to /dev/null; the body source is set by makeBody.
+ * The allocation count stays flat for streamed bodies whatever their size.
+ */
+template <typename MakeBody>
+void sendBody(benchmark::State& state, MakeBody makeBody) {
+    size_t bodyBytes = size_t(state.range(0));
+    int sink = ::open("/dev/null", O_WRONLY);
+    if (sink < 0) {
+        state.SkipWithError("cannot open /dev/null");
+        return;
+    }
+    size_t before = heapAllocations;
+    for (auto _ : state) {
+        HttpRequest::Builder builder("https://api.example.com/v1/upload", "PUT");
+        makeBody(builder, bodyBytes);
+        std::move(builder).build().sendTo(sink);
+    }
+    state.counters["allocs"] = benchmark::Counter(double(heapAllocations - before), benchmark::Counter::kAvgIterations);
+    state.SetBytesProcessed(int64_t(state.iterations() * bodyBytes));
+    ::close(sink);
+}
+
+// A file of Arg 0 bytes for the file and mapped body benchmarks.
+const char* bodyFile(size_t bodyBytes) {
+    static const char* path = "/tmp/http_request_bench.body";
+    std::FILE* file = std::fopen(path, "wb");
+    std::string block(64 * 1024, 'x');
+    for (size_t written = 0; file && written < bodyBytes; written += block.size()) {
+        std::fwrite(block.data(), 1, std::min(block.size(), bodyBytes - written), file);
+    }
+    if (file) {
+        std::fclose(file);
+    }
+    return path;
+}
+
+void BM_SendStringBody(benchmark::State& state) {
+    sendBody(state, [](HttpRequest::Builder& builder, size_t bodyBytes) {
+        builder.setBody(std::string(bodyBytes, 'x'));
+    });
+}
+BENCHMARK(BM_SendStringBody)->ArgName("bodyBytes")->Arg(1 << 20)->Arg(16 << 20);
+
+void BM_SendChunkedBody(benchmark::State& state) {
+    sendBody(state, [](HttpRequest::Builder& builder, size_t bodyBytes) {
+        builder.setBody(BodyStream::generate([left = bodyBytes](char* out, size_t capacity) mutable {
+            size_t produced = std::min(capacity, left);
+            std::memset(out, 'x', produced);
+            left -= produced;
+            return produced;
+        }));
+    });
+}
+BENCHMARK(BM_SendChunkedBody)->ArgName("bodyBytes")->Arg(1 << 20)->Arg(16 << 20);
+
+void BM_SendFileBody(benchmark::State& state) {
+    const char* path = bodyFile(size_t(state.range(0)));
+    sendBody(state, [path](HttpRequest::Builder& builder, size_t) { builder.setBody(BodyStream::openFile(path)); });
+    std::remove(path);
+}
+BENCHMARK(BM_SendFileBody)->ArgName("bodyBytes")->Arg(1 << 20)->Arg(16 << 20);
+
+void BM_SendMappedBody(benchmark::State& state) {
+    const char* path = bodyFile(size_t(state.range(0)));
+    sendBody(state, [path](HttpRequest::Builder& builder, size_t) { builder.setBody(BodyStream::mapFile(path)); });
+    std::remove(path);
+}
+BENCHMARK(BM_SendMappedBody)->ArgName("bodyBytes")->Arg(1 << 20)->Arg(16 << 20);
+
+// Per-request query values for the fan-out benchmarks: a distinct id and a page.
+struct FanOut {
+    explicit FanOut(size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            ids.push_back(std::to_string(100000 + i * 7919));
+            pages.push_back(std::to_string(i % 50));
+        }
+        idViews.assign(ids.begin(), ids.end());
+        pageViews.assign(pages.begin(), pages.end());
+    }
+
+    std::vector<std::string> ids;
+    std::vector<std::string> pages;
+    std::vector<std::string_view> idViews;
+    std::vector<std::string_view> pageViews;
+};
+
+HttpRequestTemplate fanOutTemplate() {
+    return HttpRequest::Builder("https://api.example.com/v1/users", "GET")
+        .addHeader("Authorization", "Bearer abc123")
+        .addHeader("Accept", "application/json")
+        .addHeader("User-Agent", "fanout/1.0")
+        .freeze();
+}
+
+constexpr size_t kFanOutRequests = 10000;
+
+/**
+ * Builds and serializes a fan-out of 10k requests one at a time into one buffer.
+ */
+void BM_SerializeFanOutSequential(benchmark::State& state) {
+    FanOut fanOut(kFanOutRequests);
+    HttpRequestTemplate common = fanOutTemplate();
+    std::string buffer;
+    for (auto _ : state) {
+        buffer.clear();
+        for (size_t i = 0; i < kFanOutRequests; ++i) {
+            common.request().addQueryParam("id", fanOut.ids[i]).addQueryParam("page", fanOut.pages[i]).build().serializeTo(buffer);
+        }
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * kFanOutRequests));
+}
+BENCHMARK(BM_SerializeFanOutSequential)->UseRealTime();
+
+/**
+ * Serializes the same fan-out with BatchSerializer on Arg 0 threads.
+ */
+void BM_SerializeFanOutBatch(benchmark::State& state) {
+    FanOut fanOut(kFanOutRequests);
+    HttpRequestTemplate common = fanOutTemplate();
+    BatchSerializer serializer(size_t(state.range(0)));
+    QueryColumn columns[] = {{"id", fanOut.idViews}, {"page", fanOut.pageViews}};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(serializer.serialize(common, columns).bytes());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * kFanOutRequests));
+}
+BENCHMARK(BM_SerializeFanOutBatch)->ArgName("threads")->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+HttpRequest cachedRequest() {
+    return HttpRequest::Builder("https://api.example.com/v1/users/search", "GET")
+        .addHeader("Accept", "application/json")
+        .addHeader("Accept-Language", "en-GB")
+        .addHeader("Authorization", "Bearer abc123")
+        .addQueryParam("q", "alice")
+        .addQueryParam("page", "2")
+        .addQueryParam("limit", "50")
+        .build();
+}
+
+constexpr std::string_view kVaryHeaders[] = {"Accept", "Accept-Language"};
+constexpr HeaderName kVaryHeaderNames[] = {KnownHeaders::Accept, HeaderName("Accept-Language")};
+
+/**
+ * Looks up a cached response under a key concatenated by hand from the method,
+ * URL, sorted query parameters and vary headers.
+ */
+void BM_ResponseCacheStringKey(benchmark::State& state) {
+    HttpRequest request = cachedRequest();
+    auto makeKey = [&] {
+        std::vector<std::pair<std::string_view, std::string_view>> params;
+        for (FieldList::Field param : request.getQueryParams()) {
+            params.emplace_back(param.name, param.value);
+        }
+        std::sort(params.begin(), params.end());
+        std::string key = request.getMethod() + " " + request.getUrl();
+        for (const auto& [name, value] : params) {
+            key.append("&").append(name).append("=").append(value);
+        }
+        for (std::string_view name : kVaryHeaders) {
+            key.append("|").append(request.getHeader(name).value_or(""));
+        }
+        return key;
+    };
+    ShardedCache cache({/*shardCount=*/4});
+    cache.put(makeKey(), "{\"users\": []}");
+    size_t before = heapAllocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.getShared(makeKey()));
+    }
+    state.counters["allocs"] = benchmark::Counter(double(heapAllocations - before), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ResponseCacheStringKey);
+
+/**
+ * Looks up the same response under the request's 128-bit fingerprint.
+ */
+void BM_ResponseCacheFingerprint(benchmark::State& state) {
+    HttpRequest request = cachedRequest();
+    BasicShardedCache<FlatTable> cache({/*shardCount=*/4});
+    cache.put(request.fingerprint(kVaryHeaderNames), "{\"users\": []}");
+    size_t before = heapAllocations;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.getShared(request.fingerprint(kVaryHeaderNames)));
+    }
+    state.counters["allocs"] = benchmark::Counter(double(heapAllocations - before), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ResponseCacheFingerprint);
+
+} // namespace
@@ -0,0 +1,253 @@
+#include "FactoryPattern.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> kNames = {"creditcard", "debitcard", "upi", "netbanking"};
+const std::vector<PaymentMode> kModes = {PaymentMode::CreditCard, PaymentMode::DebitCard, PaymentMode::UPI, PaymentMode::NetBanking};
+
+// Cycles through the modes so the branch pattern is not trivially predictable.
+size_t pick(size_t i, size_t count) {
+    return (i * 2654435761u) % count;
+}
+
+/**
+ * The original if/else chain, kept only as the baseline for the benchmark.
+ */
+PaymentMethod* createPaymentByComparison(const std::string& mode) {
+    if (mode == "creditcard") {
+        return new CreditCard();
+    } else if (mode == "debitcard") {
+        return new DebitCard();
+    } else if (mode == "upi") {
+        return new UPI();
+    } else if (mode == "netbanking") {
+        return new NetBanking();
+    }
+    return nullptr;
+}
+
+/**
+ * Sends payment log output to /dev/null while in scope, so benchmarks still pay
+ * for logging and writing but not for a terminal.
+ */
+class DiscardPaymentLog {
+public:
+    DiscardPaymentLog() : devNull(::open("/dev/null", O_WRONLY)) {
+        previous = PaymentLog::instance().redirect(devNull);
+    }
+
+    ~DiscardPaymentLog() {
+        PaymentLog::instance().flush();
+        PaymentLog::instance().redirect(previous);
+        ::close(devNull);
+    }
+
+private:
+    int devNull;
+    int previous;
+};
+
+void BM_CreateByComparison(benchmark::State& state) {
+    size_t i = 0;
+    for (auto _ : state) {
+        PaymentMethod* method = createPaymentByComparison(kNames[pick(i++, kNames.size())]);
+        benchmark::DoNotOptimize(method);
+        delete method;
+    }
+}
+BENCHMARK(BM_CreateByComparison);
+
+void BM_CreateByName(benchmark::State& state) {
+    size_t i = 0;
+    for (auto _ : state) {
+        PaymentMethod* method = PaymentFactory::createPayment(kNames[pick(i++, kNames.size())]);
+        benchmark::DoNotOptimize(method);
+        delete method;
+    }
+}
+BENCHMARK(BM_CreateByName);
+
+void BM_CreateByMode(benchmark::State& state) {
+    size_t i = 0;
+    for (auto _ : state) {
+        PaymentMethod* method = PaymentFactory::createPayment(kModes[pick(i++, kModes.size())]);
+        benchmark::DoNotOptimize(method);
+        delete method;
+    }
+}
+BENCHMARK(BM_CreateByMode);
+
+void BM_SharedByName(benchmark::State& state) {
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PaymentFactory::sharedPayment(kNames[pick(i++, kNames.size())]));
+    }
+}
+BENCHMARK(BM_SharedByName);
+
+void BM_SharedByMode(benchmark::State& state) {
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&PaymentFactory::sharedPayment(kModes[pick(i++, kModes.size())]));
+    }
+}
+BENCHMARK(BM_SharedByMode);
+
+/**
+ * pay() over 10k mixed methods per iteration through a virtual call, including
+ * the time the log takes to write every message out.
+ */
+void BM_PayVirtual(benchmark::State& state) {
+    std::vector<PaymentMethod*> methods;
+    for (size_t i = 0; i < 10000; ++i) {
+        methods.push_back(&PaymentFactory::sharedPayment(kModes[pick(i, kModes.size())]));
+    }
+    DiscardPaymentLog discard;
+    for (auto _ : state) {
+        for (size_t i = 0; i < methods.size(); ++i) {
+            methods[i]->pay(double(i % 100) + 0.99);
+        }
+        PaymentLog::instance().flush();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * methods.size()));
+}
+BENCHMARK(BM_PayVirtual);
+
+/**
+ * The same payments as BM_PayVirtual through std::visit over PaymentVariant.
+ */
+void BM_PayVisit(benchmark::State& state) {
+    std::vector<PaymentVariant> methods;
+    for (size_t i = 0; i < 10000; ++i) {
+        methods.push_back(PaymentFactory::createPaymentVariant(kModes[pick(i, kModes.size())]));
+    }
+    DiscardPaymentLog discard;
+    for (auto _ : state) {
+        for (size_t i = 0; i < methods.size(); ++i) {
+            pay(methods[i], double(i % 100) + 0.99);
+        }
+        PaymentLog::instance().flush();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * methods.size()));
+}
+BENCHMARK(BM_PayVisit);
+
+std::vector<PaymentRecord> makeRecords(size_t count) {
+    std::vector<PaymentRecord> records;
+    records.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        records.push_back({static_cast<PaymentMode>(pick(i, kPaymentModeCount)), double(i % 100) + 0.99});
+    }
+    return records;
+}
+
+/**
+ * Settles 100k mixed payments per iteration with one createPayment() + pay() each.
+ */
+void BM_SettleOneByOne(benchmark::State& state) {
+    std::vector<PaymentRecord> records = makeRecords(100000);
+    DiscardPaymentLog discard;
+    for (auto _ : state) {
+        for (const PaymentRecord& record : records) {
+            PaymentMethod* method = PaymentFactory::createPayment(record.mode);
+            method->pay(record.amount);
+            delete method;
+        }
+        PaymentLog::instance().flush();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * records.size()));
+}
+BENCHMARK(BM_SettleOneByOne);
+
+/**
+ * Settles the same payments as BM_SettleOneByOne through one PaymentBatch.
+ */
+void BM_SettleBatch(benchmark::State& state) {
+    std::vector<PaymentRecord> records = makeRecords(100000);
+    PaymentBatch batch;
+    DiscardPaymentLog discard;
+    for (auto _ : state) {
+        batch.process(records);
+        PaymentLog::instance().flush();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * records.size()));
+}
+BENCHMARK(BM_SettleBatch);
+
+constexpr size_t kAsyncThreads = 2;
+
+/**
+ * Round trips through AsyncPaymentEngine: Arg 0 payments in flight, then wait for all of them.
+ * The default payAsync() holds a pool thread per payment, so Arg 0 stays within the
+ * pool size; more would only measure the queue in front of the same threads.
+ */
+void BM_PayAsync(benchmark::State& state) {
+    AsyncPaymentEngine engine(kAsyncThreads, /*windowPerMethod=*/ptrdiff_t(kAsyncThreads));
+    std::vector<std::future<void>> receipts(size_t(state.range(0)));
+    DiscardPaymentLog discard;
+    for (auto _ : state) {
+        for (size_t i = 0; i < receipts.size(); ++i) {
+            receipts[i] = engine.pay(kModes[pick(i, kModes.size())], 10.00);
+        }
+        for (std::future<void>& receipt : receipts) {
+            receipt.get();
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * receipts.size()));
+}
+BENCHMARK(BM_PayAsync)->Arg(1)->Arg(int64_t(kAsyncThreads))->UseRealTime();
+
+struct Amounts {
+    std::vector<double> majorUnits;
+    std::vector<int64_t> minorUnits;
+};
+
+const Amounts& amounts() {
+    static const Amounts generated = [] {
+        Amounts made;
+        for (size_t i = 0; i < 1000000; ++i) {
+            made.minorUnits.push_back(int64_t(i * 2654435761u % 100000) + 1);
+            made.majorUnits.push_back(double(made.minorUnits.back()) / 100.0);
+        }
+        return made;
+    }();
+    return generated;
+}
+
+/**
+ * Totals 1M amounts as doubles, rounded to the cent afterwards.
+ */
+void BM_SumMajorUnits(benchmark::State& state) {
+    const std::vector<double>& values = amounts().majorUnits;
+    for (auto _ : state) {
+        double total = 0;
+        for (double amount : values) {
+            total += amount;
+        }
+        benchmark::DoNotOptimize(std::round(total * 100.0) / 100.0);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * values.size()));
+}
+BENCHMARK(BM_SumMajorUnits);
+
+/**
+ * Totals the same amounts as validated int64 minor units.
+ */
+void BM_SumMinorUnits(benchmark::State& state) {
+    const std::vector<int64_t>& values = amounts().minorUnits;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(checkedSumMinorUnits(values));
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * values.size()));
+}
+BENCHMARK(BM_SumMinorUnits);
+
+} // namespace